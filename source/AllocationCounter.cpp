@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> g_NumAllocations{};
+}
+
+namespace dae
+{
+	namespace AllocationCounter
+	{
+		uint64_t GetNumAllocations()
+		{
+			return g_NumAllocations.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+#ifdef _DEBUG
+//The array, nothrow and sized versions all end up in these
+void* operator new(size_t size)
+{
+	g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pMemory{ std::malloc(size != 0 ? size : 1) })
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	g_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pMemory{ _aligned_malloc(size != 0 ? size : 1, static_cast<size_t>(alignment)) })
+		return pMemory;
+
+	throw std::bad_alloc{};
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	std::free(pMemory);
+}
+
+void operator delete(void* pMemory, std::align_val_t) noexcept
+{
+	_aligned_free(pMemory);
+}
+#endif
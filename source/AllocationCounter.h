@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+
+namespace dae
+{
+	//Counts every allocation made through operator new in debug builds, so a frame can prove it didn't touch the heap
+	namespace AllocationCounter
+	{
+#ifdef _DEBUG
+		constexpr bool IS_COUNTING{ true };
+#else
+		constexpr bool IS_COUNTING{ false };
+#endif
+
+		//Allocations since the start of the program, over all threads. Always 0 when not counting.
+		uint64_t GetNumAllocations();
+	}
+}
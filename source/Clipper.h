@@ -0,0 +1,106 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include "Math.h"
+
+namespace dae
+{
+	namespace Clipper
+	{
+		//One bit for every plane a clip space position is on the outside of
+		enum ClipCode : uint16_t
+		{
+			//The view frustum, the rasterizer's guard band makes the side planes harmless
+			CLIP_LEFT = 1 << 0,
+			CLIP_RIGHT = 1 << 1,
+			CLIP_BOTTOM = 1 << 2,
+			CLIP_TOP = 1 << 3,
+			CLIP_NEAR = 1 << 4,
+			CLIP_FAR = 1 << 5,
+
+			//Past the guard band the fixed point positions don't fit anymore
+			GUARD_LEFT = 1 << 6,
+			GUARD_RIGHT = 1 << 7,
+			GUARD_BOTTOM = 1 << 8,
+			GUARD_TOP = 1 << 9
+		};
+
+		constexpr uint16_t VIEWPORT_PLANES{ CLIP_LEFT | CLIP_RIGHT | CLIP_BOTTOM | CLIP_TOP };
+		constexpr uint16_t GUARD_BAND_PLANES{ GUARD_LEFT | GUARD_RIGHT | GUARD_BOTTOM | GUARD_TOP };
+
+		//The planes a triangle really gets clipped against, every plane adds at most one vertex
+		constexpr uint16_t CLIP_PLANES[]{ CLIP_NEAR, GUARD_LEFT, GUARD_RIGHT, GUARD_BOTTOM, GUARD_TOP };
+		constexpr int MAX_POLYGON_VERTICES{ 3 + static_cast<int>(std::size(CLIP_PLANES)) };
+
+		//guardBand is the half size of the guard band in NDC, so 1 would be exactly the screen
+		inline uint16_t ComputeClipCode(const Vector4& position, const Vector2& guardBand)
+		{
+			uint16_t clipCode{};
+			if (position.x < -position.w) clipCode |= CLIP_LEFT;
+			if (position.x > position.w) clipCode |= CLIP_RIGHT;
+			if (position.y < -position.w) clipCode |= CLIP_BOTTOM;
+			if (position.y > position.w) clipCode |= CLIP_TOP;
+			if (position.z < 0.f) clipCode |= CLIP_NEAR;
+			if (position.z > position.w) clipCode |= CLIP_FAR;
+
+			if (position.x < -guardBand.x * position.w) clipCode |= GUARD_LEFT;
+			if (position.x > guardBand.x * position.w) clipCode |= GUARD_RIGHT;
+			if (position.y < -guardBand.y * position.w) clipCode |= GUARD_BOTTOM;
+			if (position.y > guardBand.y * position.w) clipCode |= GUARD_TOP;
+
+			return clipCode;
+		}
+
+		//Signed distance to a clip plane, positive on the inside
+		inline float GetPlaneDistance(const Vector4& position, uint16_t plane, const Vector2& guardBand)
+		{
+			switch (plane)
+			{
+			case CLIP_NEAR: return position.z;
+			case GUARD_LEFT: return position.x + guardBand.x * position.w;
+			case GUARD_RIGHT: return guardBand.x * position.w - position.x;
+			case GUARD_BOTTOM: return position.y + guardBand.y * position.w;
+			case GUARD_TOP: return guardBand.y * position.w - position.y;
+			default: return 0.f;
+			}
+		}
+
+		//Sutherland-Hodgman, one plane at a time. The polygon holds vertex indices, getPosition(index) returns a vertex's clip position
+		//and addVertex(insideIndex, outsideIndex, factor) returns the index of a new vertex that far along the edge.
+		//Returns the number of vertices left, less than 3 if nothing of the polygon is inside.
+		template<typename GetPosition, typename AddVertex>
+		int ClipPolygon(uint32_t (&polygon)[MAX_POLYGON_VERTICES], int numVertices, const Vector2& guardBand, GetPosition getPosition, AddVertex addVertex)
+		{
+			for (const uint16_t plane : CLIP_PLANES)
+			{
+				uint32_t clippedPolygon[MAX_POLYGON_VERTICES]{};
+				int numClippedVertices{};
+
+				for (int i{ 0 }; i < numVertices; ++i)
+				{
+					const uint32_t currentIndex{ polygon[i] };
+					const uint32_t nextIndex{ polygon[(i + 1) % numVertices] };
+					const float currentDistance{ GetPlaneDistance(getPosition(currentIndex), plane, guardBand) };
+					const float nextDistance{ GetPlaneDistance(getPosition(nextIndex), plane, guardBand) };
+
+					if (currentDistance >= 0.f)
+						clippedPolygon[numClippedVertices++] = currentIndex;
+
+					//Always interpolate from the inside vertex, so the neighbour sharing this edge gets the exact same new vertex
+					if (currentDistance >= 0.f && nextDistance < 0.f)
+						clippedPolygon[numClippedVertices++] = addVertex(currentIndex, nextIndex, currentDistance / (currentDistance - nextDistance));
+					else if (currentDistance < 0.f && nextDistance >= 0.f)
+						clippedPolygon[numClippedVertices++] = addVertex(nextIndex, currentIndex, nextDistance / (nextDistance - currentDistance));
+				}
+
+				if (numClippedVertices < 3)
+					return numClippedVertices;
+
+				std::copy_n(clippedPolygon, numClippedVertices, polygon);
+				numVertices = numClippedVertices;
+			}
+			return numVertices;
+		}
+	}
+}
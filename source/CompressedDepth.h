@@ -0,0 +1,154 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include "DepthFormat.h"
+#include "Rasterizer.h"
+#include "TiledLayout.h"
+
+namespace dae
+{
+	//Depth compression per raster block: a block that one triangle covers completely keeps the depth plane of that triangle
+	//instead of its pixels, so drawing it and testing against it never touches the depth buffer.
+	//Anything that needs the pixels decompresses the block first, from then on it is stored raw like without compression.
+	//Blocks are the same as the ones of the HiZBuffer, and never straddle two tiles either.
+	class CompressedDepth final
+	{
+	public:
+		enum BlockState : uint8_t
+		{
+			RAW, //The pixels are in the depth buffer
+			CLEARED, //Every pixel holds the clear value of the depth format
+			PLANE //Every pixel lies on the plane
+		};
+
+		struct Block
+		{
+			Rasterizer::PlaneEquation plane{}; //The depth plane of the triangle
+			Int2 origin{}; //The first pixel of the triangle's bounds, the plane's offsets start there
+			uint32_t triangleIndex{}; //The triangle the plane came from, coplanar triangles can share plane and origin
+			BlockState state{};
+
+			//Steps the plane the same way the raster kernels do, so a pixel gets the exact depth the triangle would have stored
+			float GetDepth(int px, int py) const
+			{
+				return plane.Evaluate(0, py - origin.y) + plane.stepX * (px - origin.x);
+			}
+
+			bool IsPlaneOf(uint32_t index) const
+			{
+				return state == PLANE && triangleIndex == index;
+			}
+		};
+
+		CompressedDepth(int width, int height) :
+			m_Width{ width },
+			m_Height{ height },
+			m_Layout{ width, height },
+			m_NumBlocksX{ (width + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE },
+			m_NumBlocksY{ (height + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE }
+		{
+			m_Blocks.resize(m_NumBlocksX * m_NumBlocksY);
+		}
+
+		//Clearing with RAW is for when compression is off, the depth buffer then gets cleared for real
+		void SetState(const Rasterizer::PixelBounds& tileBounds, BlockState state)
+		{
+			for (int blockY{ tileBounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (tileBounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+				for (int blockX{ tileBounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (tileBounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+					m_Blocks[blockX + blockY * m_NumBlocksX].state = state;
+		}
+
+		void SetPlane(int blockX, int blockY, const Rasterizer::Triangle& triangle, uint32_t triangleIndex)
+		{
+			Block& block{ m_Blocks[blockX + blockY * m_NumBlocksX] };
+			block.plane = triangle.depth;
+			block.origin = triangle.bounds.min;
+			block.triangleIndex = triangleIndex;
+			block.state = PLANE;
+		}
+
+		const Block& GetBlock(int blockX, int blockY) const { return m_Blocks[blockX + blockY * m_NumBlocksX]; }
+
+		Rasterizer::PixelBounds GetBlockBounds(int blockX, int blockY) const
+		{
+			Rasterizer::PixelBounds blockBounds{};
+			blockBounds.min = { blockX * Rasterizer::BLOCK_SIZE, blockY * Rasterizer::BLOCK_SIZE };
+			blockBounds.max = { std::min(blockBounds.min.x + Rasterizer::BLOCK_SIZE, m_Width), std::min(blockBounds.min.y + Rasterizer::BLOCK_SIZE, m_Height) };
+			return blockBounds;
+		}
+
+		//Writes the pixels of every compressed block the bounds touch to the depth buffer, whole blocks at a time
+		template<typename DepthTraits>
+		void Decompress(const Rasterizer::PixelBounds& bounds, typename DepthTraits::Storage* pDepthBuffer);
+
+		//Farthest key of a compressed block, a plane is farthest in one of the corners
+		template<typename DepthTraits>
+		uint32_t GetMaxKey(int blockX, int blockY) const;
+
+		//Bytes the block takes up: the state, and the plane or the pixels
+		static size_t GetBlockBytes(BlockState state, size_t bytesPerPixel)
+		{
+			switch (state)
+			{
+			case RAW: return sizeof(BlockState) + Rasterizer::BLOCK_SIZE * Rasterizer::BLOCK_SIZE * bytesPerPixel;
+			case PLANE: return sizeof(BlockState) + sizeof(Rasterizer::PlaneEquation) + sizeof(Int2) + sizeof(uint32_t);
+			default: return sizeof(BlockState);
+			}
+		}
+
+	private:
+		int m_Width{};
+		int m_Height{};
+		TiledLayout m_Layout{};
+		int m_NumBlocksX{};
+		int m_NumBlocksY{};
+
+		std::vector<Block> m_Blocks{};
+	};
+
+	template<typename DepthTraits>
+	void CompressedDepth::Decompress(const Rasterizer::PixelBounds& bounds, typename DepthTraits::Storage* pDepthBuffer)
+	{
+		for (int blockY{ bounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (bounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+		{
+			for (int blockX{ bounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (bounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+			{
+				Block& block{ m_Blocks[blockX + blockY * m_NumBlocksX] };
+				if (block.state == RAW)
+					continue;
+
+				const Rasterizer::PixelBounds blockBounds{ GetBlockBounds(blockX, blockY) };
+				for (int py{ blockBounds.min.y }; py < blockBounds.max.y; ++py)
+				{
+					typename DepthTraits::Storage* const pRow{ pDepthBuffer + m_Layout.GetPixelIndex(blockBounds.min.x, py) };
+					if (block.state == CLEARED)
+					{
+						std::fill_n(pRow, blockBounds.max.x - blockBounds.min.x, DepthTraits::CLEAR_VALUE);
+						continue;
+					}
+
+					for (int px{ blockBounds.min.x }; px < blockBounds.max.x; ++px)
+					{
+						pRow[px - blockBounds.min.x] = DepthTraits::ToStorage(DepthTraits::ToKey(block.GetDepth(px, py)));
+					}
+				}
+
+				block.state = RAW;
+			}
+		}
+	}
+
+	template<typename DepthTraits>
+	uint32_t CompressedDepth::GetMaxKey(int blockX, int blockY) const
+	{
+		const Block& block{ GetBlock(blockX, blockY) };
+		if (block.state == CLEARED)
+			return DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE);
+
+		const Rasterizer::PixelBounds blockBounds{ GetBlockBounds(blockX, blockY) };
+		const int lastX{ blockBounds.max.x - 1 };
+		const int lastY{ blockBounds.max.y - 1 };
+		return std::max({ DepthTraits::ToKey(block.GetDepth(blockBounds.min.x, blockBounds.min.y)), DepthTraits::ToKey(block.GetDepth(lastX, blockBounds.min.y)),
+			DepthTraits::ToKey(block.GetDepth(blockBounds.min.x, lastY)), DepthTraits::ToKey(block.GetDepth(lastX, lastY)) });
+	}
+}
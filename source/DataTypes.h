@@ -34,3 +34,31 @@ struct Vertex_Out
 	Vector3 tangent{};
 	Vector3 viewDirection{};
 };
+
+//Output of the software vertex stage, one array per stream so every stage only loads the streams it reads
+struct TransformedVertices
+{
+	//Position streams, this is all clipping, culling and binning need
+	std::vector<Vector4> clipPositions{}; //Before the perspective divide
+	std::vector<uint16_t> clipCodes{};
+	std::vector<Vector4> screenPositions{}; //x and y in pixels, z the NDC depth and w the clip space w
+
+	//Attribute streams, only read when setting up the triangles that survived culling
+	std::vector<Vector2> uvs{};
+	std::vector<Vector3> normals{};
+	std::vector<Vector3> tangents{};
+	std::vector<Vector3> viewDirections{};
+
+	size_t Size() const { return clipPositions.size(); }
+
+	void Resize(size_t size)
+	{
+		clipPositions.resize(size);
+		clipCodes.resize(size);
+		screenPositions.resize(size);
+		uvs.resize(size);
+		normals.resize(size);
+		tangents.resize(size);
+		viewDirections.resize(size);
+	}
+};
@@ -0,0 +1,171 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+
+namespace dae
+{
+	//Formats of the software depth buffer. Whatever a format stores, it compares as a 32 bit key where smaller is nearer,
+	//so the depth test is always one integer compare and the hierarchical depth never has to know the format.
+	//Keys stay below 2^31, which lets the SIMD kernels use the signed compares SSE2 and AVX2 have.
+	namespace Depth
+	{
+		enum Format
+		{
+			D32_FLOAT, //NDC depth as it comes out of the projection
+			D24_UNORM, //In the low 24 bits of 32, so a pixel stays one aligned load
+			D16_UNORM, //Half the bandwidth, at the price of the precision far from the near plane
+			D32_FLOAT_REVERSED, //Near / w: an infinite far plane, 1 at the near plane going to 0 in the distance
+			NUM_FORMATS
+		};
+
+		inline const char* GetFormatName(Format format)
+		{
+			switch (format)
+			{
+			case D24_UNORM: return "D24_UNORM";
+			case D16_UNORM: return "D16_UNORM";
+			case D32_FLOAT_REVERSED: return "D32_FLOAT_REVERSED";
+			default: return "D32_FLOAT";
+			}
+		}
+
+		//Per format: the type in memory, the conversions to and from keys, and the same for 4 and 8 pixels at once.
+		//Depths outside of [0, 1] never get converted, the kernels reject them first.
+		template<Format format>
+		struct Traits;
+
+		template<>
+		struct Traits<D32_FLOAT>
+		{
+			using Storage = float;
+			static constexpr Storage CLEAR_VALUE{ 1.f };
+
+			//Positive floats sort the same as their bits. Adding 0 turns -0 into 0, its sign bit would sort it before everything.
+			static uint32_t ToKey(float depth) { return std::bit_cast<uint32_t>(depth + 0.f); }
+			static uint32_t FromStorage(Storage stored) { return std::bit_cast<uint32_t>(stored); }
+			static Storage ToStorage(uint32_t key) { return std::bit_cast<float>(key); }
+			static float ToDepth(uint32_t key) { return std::bit_cast<float>(key); }
+
+			static __m128i ToKeys(__m128 depths) { return _mm_castps_si128(_mm_add_ps(depths, _mm_setzero_ps())); }
+			static __m128i LoadKeys4(const Storage* pStored) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pStored)); }
+			static void StoreKeys4(Storage* pStored, __m128i keys) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pStored), keys); }
+
+			static __m256i ToKeys(__m256 depths) { return _mm256_castps_si256(_mm256_add_ps(depths, _mm256_setzero_ps())); }
+			static __m256i LoadKeys8(const Storage* pStored) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pStored)); }
+			static void StoreKeys8(Storage* pStored, __m256i keys) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pStored), keys); }
+		};
+
+		//Unsigned normalized formats store the key itself, rounded to the nearest step.
+		//The last half step in front of the far plane would round to the clear value and leave the pixel empty, it gets the step before that.
+		template<uint32_t maxValue, typename StorageType>
+		struct UnormTraits
+		{
+			using Storage = StorageType;
+			static constexpr Storage CLEAR_VALUE{ static_cast<Storage>(maxValue) };
+
+			static uint32_t ToKey(float depth) { return static_cast<uint32_t>(std::lrint(std::min(depth * static_cast<float>(maxValue), static_cast<float>(maxValue - 1)))); }
+			static uint32_t FromStorage(Storage stored) { return stored; }
+			static Storage ToStorage(uint32_t key) { return static_cast<Storage>(key); }
+			static float ToDepth(uint32_t key) { return static_cast<float>(key) / static_cast<float>(maxValue); }
+
+			static __m128i ToKeys(__m128 depths)
+			{
+				return _mm_cvtps_epi32(_mm_min_ps(_mm_mul_ps(depths, _mm_set1_ps(static_cast<float>(maxValue))), _mm_set1_ps(static_cast<float>(maxValue - 1))));
+			}
+			static __m256i ToKeys(__m256 depths)
+			{
+				return _mm256_cvtps_epi32(_mm256_min_ps(_mm256_mul_ps(depths, _mm256_set1_ps(static_cast<float>(maxValue))), _mm256_set1_ps(static_cast<float>(maxValue - 1))));
+			}
+		};
+
+		template<>
+		struct Traits<D24_UNORM> : UnormTraits<(1u << 24) - 1, uint32_t>
+		{
+			static __m128i LoadKeys4(const Storage* pStored) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pStored)); }
+			static void StoreKeys4(Storage* pStored, __m128i keys) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pStored), keys); }
+
+			static __m256i LoadKeys8(const Storage* pStored) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pStored)); }
+			static void StoreKeys8(Storage* pStored, __m256i keys) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pStored), keys); }
+		};
+
+		template<>
+		struct Traits<D16_UNORM> : UnormTraits<(1u << 16) - 1, uint16_t>
+		{
+			static __m128i LoadKeys4(const Storage* pStored)
+			{
+				return _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(pStored)), _mm_setzero_si128());
+			}
+			static void StoreKeys4(Storage* pStored, __m128i keys)
+			{
+				//SSE2 only packs with signed saturation, so shift the keys into the signed range and back
+				const __m128i signedKeys{ _mm_sub_epi32(keys, _mm_set1_epi32(0x8000)) };
+				const __m128i packed{ _mm_xor_si128(_mm_packs_epi32(signedKeys, signedKeys), _mm_set1_epi16(static_cast<short>(0x8000))) };
+				_mm_storel_epi64(reinterpret_cast<__m128i*>(pStored), packed);
+			}
+
+			static __m256i LoadKeys8(const Storage* pStored) { return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pStored))); }
+			static void StoreKeys8(Storage* pStored, __m256i keys)
+			{
+				const __m128i packed{ _mm_packus_epi32(_mm256_castsi256_si128(keys), _mm256_extracti128_si256(keys, 1)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pStored), packed);
+			}
+		};
+
+		//Stores the reversed depth as a float, its key counts down from the bits of 1 so nearer still means smaller
+		template<>
+		struct Traits<D32_FLOAT_REVERSED>
+		{
+			using Storage = float;
+			static constexpr Storage CLEAR_VALUE{ 0.f };
+			static constexpr uint32_t ONE_BITS{ 0x3F800000 };
+
+			static uint32_t ToKey(float depth) { return ONE_BITS - std::bit_cast<uint32_t>(depth + 0.f); }
+			static uint32_t FromStorage(Storage stored) { return ONE_BITS - std::bit_cast<uint32_t>(stored); }
+			static Storage ToStorage(uint32_t key) { return std::bit_cast<float>(ONE_BITS - key); }
+			static float ToDepth(uint32_t key) { return std::bit_cast<float>(ONE_BITS - key); }
+
+			static __m128i ToKeys(__m128 depths) { return _mm_sub_epi32(_mm_set1_epi32(ONE_BITS), _mm_castps_si128(_mm_add_ps(depths, _mm_setzero_ps()))); }
+			static __m128i LoadKeys4(const Storage* pStored) { return _mm_sub_epi32(_mm_set1_epi32(ONE_BITS), _mm_loadu_si128(reinterpret_cast<const __m128i*>(pStored))); }
+			static void StoreKeys4(Storage* pStored, __m128i keys) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pStored), _mm_sub_epi32(_mm_set1_epi32(ONE_BITS), keys)); }
+
+			static __m256i ToKeys(__m256 depths) { return _mm256_sub_epi32(_mm256_set1_epi32(ONE_BITS), _mm256_castps_si256(_mm256_add_ps(depths, _mm256_setzero_ps()))); }
+			static __m256i LoadKeys8(const Storage* pStored) { return _mm256_sub_epi32(_mm256_set1_epi32(ONE_BITS), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pStored))); }
+			static void StoreKeys8(Storage* pStored, __m256i keys) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(pStored), _mm256_sub_epi32(_mm256_set1_epi32(ONE_BITS), keys)); }
+		};
+
+		//Calls function with a Traits object of the format, so the per pixel code gets compiled once for every format
+		template<typename Function>
+		decltype(auto) Dispatch(Format format, Function&& function)
+		{
+			switch (format)
+			{
+			case D24_UNORM: return function(Traits<D24_UNORM>{});
+			case D16_UNORM: return function(Traits<D16_UNORM>{});
+			case D32_FLOAT_REVERSED: return function(Traits<D32_FLOAT_REVERSED>{});
+			default: return function(Traits<D32_FLOAT>{});
+			}
+		}
+
+		inline uint32_t ToKey(Format format, float depth)
+		{
+			return Dispatch(format, [depth](auto traits) { return decltype(traits)::ToKey(depth); });
+		}
+
+		inline uint32_t GetClearKey(Format format)
+		{
+			return Dispatch(format, [](auto traits)
+				{
+					using FormatTraits = decltype(traits);
+					return FormatTraits::FromStorage(FormatTraits::CLEAR_VALUE);
+				});
+		}
+
+		inline size_t GetBytesPerPixel(Format format)
+		{
+			return Dispatch(format, [](auto traits) { return sizeof(typename decltype(traits)::Storage); });
+		}
+	}
+}
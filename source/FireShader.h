@@ -0,0 +1,36 @@
+#pragma once
+#include <cmath>
+
+#include "SoftwareShader.h"
+#include "Texture.h"
+
+namespace dae
+{
+	//transparency.fx for the software path: the diffuse map with its alpha, blended over the opaque pass
+	struct FireShader
+	{
+		struct Varyings
+		{
+			Vector2 uv{};
+		};
+
+		Matrix worldViewProjection{};
+		const Texture* pDiffuseMap{};
+
+		Vector4 VertexShader(const Vertex& vertex, Varyings& varyings) const
+		{
+			varyings.uv = vertex.uv;
+			return worldViewProjection.TransformPoint({ vertex.position, 1.f });
+		}
+
+		PixelOutput PixelShader(const Varyings& varyings) const
+		{
+			//Wrap addressing, same as the sampler state of the effect
+			const Vector2 uv{ varyings.uv.x - std::floor(varyings.uv.x), varyings.uv.y - std::floor(varyings.uv.y) };
+
+			PixelOutput output{};
+			output.color = pDiffuseMap->Sample(uv, output.alpha);
+			return output;
+		}
+	};
+}
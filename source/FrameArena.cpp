@@ -0,0 +1,52 @@
+#include "pch.h"
+#include "FrameArena.h"
+
+namespace dae
+{
+	FrameArena::FrameArena(size_t capacity) :
+		m_pMemory{ static_cast<std::byte*>(::operator new(capacity, std::align_val_t{ alignof(std::max_align_t) })) },
+		m_Capacity{ capacity }
+	{
+	}
+
+	FrameArena::~FrameArena()
+	{
+		Reset();
+		::operator delete(m_pMemory, std::align_val_t{ alignof(std::max_align_t) });
+	}
+
+	void* FrameArena::Allocate(size_t size, size_t alignment)
+	{
+		const size_t offset{ (m_UsedBytes + alignment - 1) & ~(alignment - 1) };
+		if (offset + size <= m_Capacity)
+		{
+			m_UsedBytes = offset + size;
+			return m_pMemory + offset;
+		}
+
+		//Only happens when a frame needs more than any frame before it
+		void* pBlock{ ::operator new(size, std::align_val_t{ alignment }) };
+		m_OverflowBlocks.push_back({ pBlock, alignment });
+		m_OverflowBytes += size + alignment;
+		return pBlock;
+	}
+
+	void FrameArena::Reset()
+	{
+		if (!m_OverflowBlocks.empty())
+		{
+			for (const OverflowBlock& block : m_OverflowBlocks)
+				::operator delete(block.pMemory, std::align_val_t{ block.alignment });
+			m_OverflowBlocks.clear();
+
+			//Grow so everything of the last frame fits in one go from now on
+			const size_t newCapacity{ std::max(m_Capacity * 2, m_UsedBytes + m_OverflowBytes) };
+			::operator delete(m_pMemory, std::align_val_t{ alignof(std::max_align_t) });
+			m_pMemory = static_cast<std::byte*>(::operator new(newCapacity, std::align_val_t{ alignof(std::max_align_t) }));
+			m_Capacity = newCapacity;
+			m_OverflowBytes = 0;
+		}
+
+		m_UsedBytes = 0;
+	}
+}
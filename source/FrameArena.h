@@ -0,0 +1,83 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace dae
+{
+	//Bump allocator for everything that only lives for one frame: allocating moves a pointer, everything is freed at once by Reset.
+	//Running out only costs heap allocations in that one frame, the next Reset grows the block to fit all of it.
+	class FrameArena final
+	{
+	public:
+		explicit FrameArena(size_t capacity);
+		~FrameArena();
+
+		FrameArena(const FrameArena&) = delete;
+		FrameArena(FrameArena&&) noexcept = delete;
+		FrameArena& operator=(const FrameArena&) = delete;
+		FrameArena& operator=(FrameArena&&) noexcept = delete;
+
+		void* Allocate(size_t size, size_t alignment);
+
+		//Call at the start of a frame, nothing allocated before it may be used anymore
+		void Reset();
+
+		size_t GetUsedBytes() const { return m_UsedBytes + m_OverflowBytes; }
+		size_t GetCapacity() const { return m_Capacity; }
+
+	private:
+		std::byte* m_pMemory{};
+		size_t m_Capacity{};
+		size_t m_UsedBytes{};
+
+		//Whatever didn't fit this frame
+		struct OverflowBlock
+		{
+			void* pMemory{};
+			size_t alignment{};
+		};
+		std::vector<OverflowBlock> m_OverflowBlocks{};
+		size_t m_OverflowBytes{};
+	};
+
+	//Lets standard containers take their memory from a FrameArena. Deallocating does nothing, the memory comes back on Reset.
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		using value_type = T;
+
+		//Assigning a container also hands over where its memory comes from
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		ArenaAllocator() = default;
+		explicit ArenaAllocator(FrameArena* pArena) : m_pArena{ pArena } {}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) : m_pArena{ other.GetArena() } {}
+
+		T* allocate(size_t count)
+		{
+			return static_cast<T*>(m_pArena->Allocate(count * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) {}
+
+		FrameArena* GetArena() const { return m_pArena; }
+
+		template<typename U>
+		bool operator==(const ArenaAllocator<U>& other) const { return m_pArena == other.GetArena(); }
+		template<typename U>
+		bool operator!=(const ArenaAllocator<U>& other) const { return m_pArena != other.GetArena(); }
+
+	private:
+		FrameArena* m_pArena{};
+	};
+
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
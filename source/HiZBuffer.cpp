@@ -0,0 +1,90 @@
+#include "pch.h"
+#include "HiZBuffer.h"
+
+namespace dae
+{
+	HiZBuffer::HiZBuffer(const void* pDepthBuffer, const CompressedDepth* pCompressedDepth, Depth::Format format, int width, int height) :
+		m_pDepthBuffer{ pDepthBuffer },
+		m_pCompressedDepth{ pCompressedDepth },
+		m_Format{ format },
+		m_Width{ width },
+		m_Height{ height },
+		m_Layout{ width, height },
+		m_NumBlocksX{ (width + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE },
+		m_NumBlocksY{ (height + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE }
+	{
+		m_MaxKeys.resize(m_NumBlocksX * m_NumBlocksY, Depth::GetClearKey(format));
+		m_IsDirty.resize(m_NumBlocksX * m_NumBlocksY, false);
+	}
+
+	void HiZBuffer::Clear(const Rasterizer::PixelBounds& tileBounds, uint32_t clearKey)
+	{
+		for (int blockY{ tileBounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (tileBounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+		{
+			for (int blockX{ tileBounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (tileBounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+			{
+				m_MaxKeys[blockX + blockY * m_NumBlocksX] = clearKey;
+				m_IsDirty[blockX + blockY * m_NumBlocksX] = false;
+			}
+		}
+	}
+
+	void HiZBuffer::MarkDirty(const Rasterizer::PixelBounds& bounds)
+	{
+		for (int blockY{ bounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (bounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+			for (int blockX{ bounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (bounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+				m_IsDirty[blockX + blockY * m_NumBlocksX] = true;
+	}
+
+	bool HiZBuffer::IsOccluded(const Rasterizer::PixelBounds& bounds, uint32_t minKey)
+	{
+		//A pixel passes the depth test when it is at most as far as the stored depth
+		for (int blockY{ bounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (bounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+		{
+			for (int blockX{ bounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (bounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+			{
+				if (minKey <= GetMaxKey(blockX, blockY))
+					return false;
+			}
+		}
+
+		return true;
+	}
+
+	uint32_t HiZBuffer::GetMaxKey(int blockX, int blockY)
+	{
+		const int blockIdx{ blockX + blockY * m_NumBlocksX };
+		if (!m_IsDirty[blockIdx])
+			return m_MaxKeys[blockIdx];
+
+		const int startX{ blockX * Rasterizer::BLOCK_SIZE };
+		const int startY{ blockY * Rasterizer::BLOCK_SIZE };
+		const int endX{ std::min(startX + Rasterizer::BLOCK_SIZE, m_Width) };
+		const int endY{ std::min(startY + Rasterizer::BLOCK_SIZE, m_Height) };
+
+		const uint32_t maxKey{ Depth::Dispatch(m_Format, [&](auto traits)
+			{
+				using DepthTraits = decltype(traits);
+				if (m_pCompressedDepth->GetBlock(blockX, blockY).state != CompressedDepth::RAW)
+					return m_pCompressedDepth->GetMaxKey<DepthTraits>(blockX, blockY);
+
+				const auto* pDepthBuffer{ static_cast<const typename DepthTraits::Storage*>(m_pDepthBuffer) };
+
+				uint32_t maxKey{ 0 };
+				for (int sample{ 0 }; sample < m_SampleCount; ++sample)
+				{
+					for (int py{ startY }; py < endY; ++py)
+					{
+						const auto* const pRow{ pDepthBuffer + sample * m_Layout.GetNumPixels() + m_Layout.GetPixelIndex(startX, py) };
+						for (int px{ startX }; px < endX; ++px)
+							maxKey = std::max(maxKey, DepthTraits::FromStorage(pRow[px - startX]));
+					}
+				}
+				return maxKey;
+			}) };
+
+		m_MaxKeys[blockIdx] = maxKey;
+		m_IsDirty[blockIdx] = false;
+		return maxKey;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <vector>
+#include "CompressedDepth.h"
+#include "DepthFormat.h"
+#include "Rasterizer.h"
+#include "TiledLayout.h"
+
+namespace dae
+{
+	//Keeps the farthest depth of every raster block of the depth buffer, so a triangle (or a block of one)
+	//that is behind everything already drawn there can be skipped before any per pixel work.
+	//Blocks never straddle two tiles, so every tile thread only touches its own blocks.
+	//Depths are depth keys, which makes it work the same for every depth format.
+	//Compressed blocks get their farthest depth from their plane, without reading the depth buffer.
+	class HiZBuffer final
+	{
+	public:
+		HiZBuffer(const void* pDepthBuffer, const CompressedDepth* pCompressedDepth, Depth::Format format, int width, int height);
+
+		//Only between frames, every tile gets cleared before it is tested again
+		void SetFormat(Depth::Format format) { m_Format = format; }
+		//Multisampled depth has one plane of m_Layout.GetNumPixels() per sample, the farthest of every sample counts
+		void SetSampleCount(int sampleCount) { m_SampleCount = sampleCount; }
+
+		//Call after the depth of the tile got cleared
+		void Clear(const Rasterizer::PixelBounds& tileBounds, uint32_t clearKey);
+
+		//Call after writing depth, the blocks get their farthest depth recalculated when they are tested next
+		void MarkDirty(const Rasterizer::PixelBounds& bounds);
+
+		//True when every block the bounds touch already holds something closer than minKey
+		bool IsOccluded(const Rasterizer::PixelBounds& bounds, uint32_t minKey);
+
+	private:
+		uint32_t GetMaxKey(int blockX, int blockY);
+
+		const void* m_pDepthBuffer{};
+		const CompressedDepth* m_pCompressedDepth{};
+		Depth::Format m_Format{};
+		int m_SampleCount{ 1 };
+		int m_Width{};
+		int m_Height{};
+		TiledLayout m_Layout{};
+		int m_NumBlocksX{};
+		int m_NumBlocksY{};
+
+		std::vector<uint32_t> m_MaxKeys{};
+		std::vector<uint8_t> m_IsDirty{};
+	};
+}
@@ -0,0 +1,273 @@
+#include "pch.h"
+#include "IndexOptimizer.h"
+
+namespace dae
+{
+	namespace IndexOptimizer
+	{
+		namespace
+		{
+			//Forsyth's scoring, tuned for an LRU cache of this size. It works just as well for smaller FIFO caches.
+			constexpr int SCORING_CACHE_SIZE{ 32 };
+			constexpr float CACHE_DECAY_POWER{ 1.5f };
+			constexpr float LAST_TRIANGLE_SCORE{ 0.75f };
+			constexpr float VALENCE_BOOST_SCALE{ 2.f };
+			constexpr float VALENCE_BOOST_POWER{ 0.5f };
+
+			float GetVertexScore(int numActiveTriangles, int cachePosition)
+			{
+				//Nothing left to draw with this vertex
+				if (numActiveTriangles == 0)
+					return -1.f;
+
+				float score{};
+				if (cachePosition < 0)
+				{
+					//Not in the cache
+				}
+				else if (cachePosition < 3)
+				{
+					//Used by the last triangle, a fixed score so the order doesn't just zig-zag between strips
+					score = LAST_TRIANGLE_SCORE;
+				}
+				else
+				{
+					const float scaler{ 1.f / (SCORING_CACHE_SIZE - 3) };
+					score = powf(1.f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+				}
+
+				//Vertices with few triangles left get finished first, so they don't end up as lonely triangles later on
+				score += VALENCE_BOOST_SCALE * powf(static_cast<float>(numActiveTriangles), -VALENCE_BOOST_POWER);
+				return score;
+			}
+		}
+
+		float ComputeACMR(const std::vector<uint32_t>& indices, size_t numVertices, int cacheSize)
+		{
+			if (indices.empty())
+				return 0.f;
+
+			//A vertex is still in the FIFO when fewer than cacheSize misses happened since it got in
+			std::vector<int64_t> insertTimes(numVertices, INT64_MIN / 2);
+			int64_t misses{};
+			for (const uint32_t index : indices)
+			{
+				if (misses - insertTimes[index] >= cacheSize)
+					insertTimes[index] = misses++;
+			}
+
+			return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+		}
+
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t numVertices)
+		{
+			const size_t numTriangles{ indices.size() / 3 };
+			if (numTriangles == 0)
+				return;
+
+			//Per vertex, the triangles using it that aren't drawn yet. The first numActiveTriangles of its range are still active.
+			std::vector<int> numActiveTriangles(numVertices);
+			for (const uint32_t index : indices)
+				++numActiveTriangles[index];
+
+			std::vector<uint32_t> firstTriangle(numVertices + 1);
+			for (size_t vertex{ 0 }; vertex < numVertices; ++vertex)
+				firstTriangle[vertex + 1] = firstTriangle[vertex] + numActiveTriangles[vertex];
+
+			std::vector<uint32_t> vertexTriangles(indices.size());
+			std::vector<uint32_t> fillCounts(numVertices);
+			for (uint32_t triangle{ 0 }; triangle < numTriangles; ++triangle)
+			{
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint32_t vertex{ indices[triangle * 3 + corner] };
+					vertexTriangles[firstTriangle[vertex] + fillCounts[vertex]++] = triangle;
+				}
+			}
+
+			std::vector<int> cachePositions(numVertices, -1);
+			std::vector<float> vertexScores(numVertices);
+			for (size_t vertex{ 0 }; vertex < numVertices; ++vertex)
+				vertexScores[vertex] = GetVertexScore(numActiveTriangles[vertex], -1);
+
+			std::vector<float> triangleScores(numTriangles);
+			for (size_t triangle{ 0 }; triangle < numTriangles; ++triangle)
+				triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+
+			std::vector<uint8_t> isDrawn(numTriangles, false);
+			std::vector<uint32_t> optimizedIndices{};
+			optimizedIndices.reserve(indices.size());
+
+			//The cache gets the 3 vertices of the new triangle in front before the oldest ones fall off
+			uint32_t cache[SCORING_CACHE_SIZE + 3]{};
+			int cacheSize{};
+
+			int64_t bestTriangle{ -1 };
+			size_t nextUndrawnTriangle{};
+			for (size_t numDrawn{ 0 }; numDrawn < numTriangles; ++numDrawn)
+			{
+				//Nothing in the cache has triangles left, start over with the best triangle of the whole mesh
+				if (bestTriangle < 0)
+				{
+					float bestScore{ -FLT_MAX };
+					while (isDrawn[nextUndrawnTriangle])
+						++nextUndrawnTriangle;
+
+					for (size_t triangle{ nextUndrawnTriangle }; triangle < numTriangles; ++triangle)
+					{
+						if (!isDrawn[triangle] && triangleScores[triangle] > bestScore)
+						{
+							bestScore = triangleScores[triangle];
+							bestTriangle = static_cast<int64_t>(triangle);
+						}
+					}
+				}
+
+				const uint32_t* pTriangle{ &indices[bestTriangle * 3] };
+				optimizedIndices.insert(optimizedIndices.end(), pTriangle, pTriangle + 3);
+				isDrawn[bestTriangle] = true;
+
+				uint32_t newCache[SCORING_CACHE_SIZE + 3]{};
+				int newCacheSize{};
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint32_t vertex{ pTriangle[corner] };
+					newCache[newCacheSize++] = vertex;
+
+					//Take the triangle out of the active part of the vertex's range
+					uint32_t* pFirst{ &vertexTriangles[firstTriangle[vertex]] };
+					uint32_t* pLast{ pFirst + numActiveTriangles[vertex] };
+					std::swap(*std::find(pFirst, pLast, static_cast<uint32_t>(bestTriangle)), *(pLast - 1));
+					--numActiveTriangles[vertex];
+				}
+
+				for (int i{ 0 }; i < cacheSize; ++i)
+				{
+					const uint32_t vertex{ cache[i] };
+					if (vertex != pTriangle[0] && vertex != pTriangle[1] && vertex != pTriangle[2])
+						newCache[newCacheSize++] = vertex;
+				}
+
+				//Rescore everything that moved in the cache, the ones that fell off included
+				bestTriangle = -1;
+				float bestScore{ -FLT_MAX };
+				for (int i{ 0 }; i < newCacheSize; ++i)
+				{
+					const uint32_t vertex{ newCache[i] };
+					cachePositions[vertex] = i < SCORING_CACHE_SIZE ? i : -1;
+
+					const float newScore{ GetVertexScore(numActiveTriangles[vertex], cachePositions[vertex]) };
+					const float scoreChange{ newScore - vertexScores[vertex] };
+					vertexScores[vertex] = newScore;
+
+					for (int j{ 0 }; j < numActiveTriangles[vertex]; ++j)
+					{
+						const uint32_t triangle{ vertexTriangles[firstTriangle[vertex] + j] };
+						triangleScores[triangle] += scoreChange;
+
+						if (triangleScores[triangle] > bestScore)
+						{
+							bestScore = triangleScores[triangle];
+							bestTriangle = triangle;
+						}
+					}
+				}
+
+				cacheSize = std::min(newCacheSize, SCORING_CACHE_SIZE);
+				std::copy_n(newCache, cacheSize, cache);
+			}
+
+			indices = std::move(optimizedIndices);
+		}
+
+		void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex_PosTex>& vertices)
+		{
+			const size_t numTriangles{ indices.size() / 3 };
+			if (numTriangles == 0)
+				return;
+
+			struct Cluster
+			{
+				size_t firstTriangle{};
+				size_t numTriangles{};
+				float sortKey{};
+			};
+
+			//A triangle missing the cache with all 3 vertices starts a new cluster, moving clusters around doesn't add misses
+			std::vector<Cluster> clusters{};
+			std::vector<int64_t> insertTimes(vertices.size(), INT64_MIN / 2);
+			int64_t misses{};
+			for (size_t triangle{ 0 }; triangle < numTriangles; ++triangle)
+			{
+				int numMisses{};
+				for (int corner{ 0 }; corner < 3; ++corner)
+				{
+					const uint32_t vertex{ indices[triangle * 3 + corner] };
+					if (misses - insertTimes[vertex] >= FIFO_CACHE_SIZE)
+					{
+						insertTimes[vertex] = misses++;
+						++numMisses;
+					}
+				}
+
+				if (numMisses == 3 || clusters.empty())
+					clusters.push_back({ triangle, 0 });
+				++clusters.back().numTriangles;
+			}
+
+			Vector3 meshCenter{};
+			for (const uint32_t index : indices)
+				meshCenter += vertices[index].position;
+			meshCenter /= static_cast<float>(indices.size());
+
+			//Clusters far from the center and facing outward are the most likely to cover the others
+			for (Cluster& cluster : clusters)
+			{
+				Vector3 center{};
+				Vector3 normal{};
+				for (size_t i{ cluster.firstTriangle * 3 }; i < (cluster.firstTriangle + cluster.numTriangles) * 3; ++i)
+				{
+					center += vertices[indices[i]].position;
+					normal += vertices[indices[i]].normal;
+				}
+				center /= static_cast<float>(cluster.numTriangles * 3);
+
+				if (normal.SqrMagnitude() > 0.f)
+					normal.Normalize();
+
+				cluster.sortKey = Vector3::Dot(center - meshCenter, normal);
+			}
+
+			std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+			std::vector<uint32_t> sortedIndices{};
+			sortedIndices.reserve(indices.size());
+			for (const Cluster& cluster : clusters)
+				sortedIndices.insert(sortedIndices.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + (cluster.firstTriangle + cluster.numTriangles) * 3);
+
+			indices = std::move(sortedIndices);
+		}
+
+		void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex_PosTex>& vertices)
+		{
+			constexpr uint32_t UNUSED{ UINT32_MAX };
+			std::vector<uint32_t> remap(vertices.size(), UNUSED);
+			std::vector<Vertex_PosTex> sortedVertices{};
+			sortedVertices.reserve(vertices.size());
+
+			//Vertices no index uses get dropped
+			for (uint32_t& index : indices)
+			{
+				if (remap[index] == UNUSED)
+				{
+					remap[index] = static_cast<uint32_t>(sortedVertices.size());
+					sortedVertices.push_back(vertices[index]);
+				}
+
+				index = remap[index];
+			}
+
+			vertices = std::move(sortedVertices);
+		}
+	}
+}
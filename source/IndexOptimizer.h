@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Math.h"
+#include "DataTypes.h"
+
+namespace dae
+{
+	//Load time reordering of a mesh's triangles and vertices. Only the order changes, every triangle keeps its winding.
+	namespace IndexOptimizer
+	{
+		//The post-transform cache the ACMR gets reported for, a FIFO like the one of most GPUs
+		constexpr int FIFO_CACHE_SIZE{ 16 };
+
+		//Average cache miss ratio: vertices transformed per triangle. Can't get lower than the number of vertices per triangle.
+		float ComputeACMR(const std::vector<uint32_t>& indices, size_t numVertices, int cacheSize = FIFO_CACHE_SIZE);
+
+		//Tom Forsyth's linear-speed vertex cache optimisation, every next triangle reuses as much of the cache as possible
+		void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t numVertices);
+
+		//Splits the cache optimized order where the cache starts over anyway and draws the clusters facing away from
+		//the center of the mesh first, those are the ones hiding the rest. Costs (almost) no cache misses.
+		void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex_PosTex>& vertices);
+
+		//Renumbers the vertices in the order the indices first use them, so the vertex stage reads memory front to back
+		void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex_PosTex>& vertices);
+	}
+}
@@ -5,6 +5,7 @@
 #include "Camera.h"
 #include "Texture.h"
 #include "Utils.h"
+#include "IndexOptimizer.h"
 #include "DataTypes.h"
 
 using namespace dae;
@@ -13,12 +14,31 @@ class Mesh
 {
 public:
 
+	//Which triangles the software rasterizer throws away, front facing triangles are clockwise on screen
+	enum CullMode
+	{
+		BACK,
+		FRONT,
+		NONE
+	};
+
 	Mesh(ID3D11Device* pDevice, Effect* pEffect, std::string objPath)
 	{
 		m_pEffect = pEffect;
 		m_pEffect->CreateInputLayout(pDevice);
 
 		Utils::ParseOBJ(objPath, m_Vertices, m_Indices);
+		const size_t numFaceCorners{ m_Indices.size() };
+		const float parsedACMR{ IndexOptimizer::ComputeACMR(m_Indices, m_Vertices.size()) };
+
+		//First make every triangle reuse what's in the vertex cache, then put the outside of the mesh in front to cut overdraw
+		IndexOptimizer::OptimizeVertexCache(m_Indices, m_Vertices.size());
+		IndexOptimizer::OptimizeOverdraw(m_Indices, m_Vertices);
+		IndexOptimizer::OptimizeVertexFetch(m_Indices, m_Vertices);
+
+		std::cout << "\033[1;33m(SHARED) " << objPath << ": " << numFaceCorners << " face corners welded into " << m_Vertices.size() << " vertices, ACMR "
+			<< parsedACMR << " -> " << IndexOptimizer::ComputeACMR(m_Indices, m_Vertices.size()) << " (" << IndexOptimizer::FIFO_CACHE_SIZE << " entry cache, "
+			<< static_cast<float>(m_Vertices.size()) / (m_Indices.size() / 3) << " at best)\033[0m" << std::endl;
 		m_SoftwareVertives.resize(m_Vertices.size());
 		for (int i{0}; i < m_Vertices.size(); ++i)
 		{
@@ -56,9 +76,9 @@ public:
 		if (FAILED(result))
 			return;
 	}
+	//The effect isn't owned by the mesh, it goes back to the pool it came from
 	~Mesh()
 	{
-		delete m_pEffect;
 		m_pIndexBuffer->Release();
 		m_pVertexBuffer->Release();
 		
@@ -98,6 +118,9 @@ public:
 		m_pEffect->CycleCurrentFilteringTechnique();
 	}
 
+	CullMode GetCullMode() const { return m_CullMode; }
+	void SetCullMode(CullMode cullMode) { m_CullMode = cullMode; }
+
 	void InitializeMeshMatrices(Vector3 position, Vector3 rotation, Vector3 scale)
 	{
 		m_ScaleMatrix = Matrix::CreateScale(scale);
@@ -126,7 +149,7 @@ public:
 	std::vector<uint32_t> m_Indices{};
 
 	std::vector<Vertex> m_SoftwareVertives{};
-	std::vector<Vertex_Out> m_VerticesOut{};
+	TransformedVertices m_VerticesOut{};
 
 	Matrix worldMatrix{};
 
@@ -136,6 +159,8 @@ private:
 	ID3D11Buffer* m_pIndexBuffer{};
 	uint32_t m_NumIndices{};
 
+	CullMode m_CullMode{ BACK };
+
 	Matrix m_TranslationMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
 	Matrix m_RotationMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
 	Matrix m_ScaleMatrix{ Vector3::UnitX, Vector3::UnitY, Vector3::UnitZ, Vector3::Zero };
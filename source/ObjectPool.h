@@ -0,0 +1,74 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace dae
+{
+	//A fixed number of slots for long-lived objects of one type, all in one block that never moves.
+	//Create and Destroy take the place of new and delete, a destroyed object's slot gets reused.
+	template<typename T>
+	class ObjectPool final
+	{
+	public:
+		explicit ObjectPool(size_t capacity) :
+			m_Slots(capacity)
+		{
+			for (size_t i{ 0 }; i + 1 < capacity; ++i)
+				m_Slots[i].pNextFree = &m_Slots[i + 1];
+
+			m_pFirstFree = capacity > 0 ? &m_Slots[0] : nullptr;
+		}
+
+		~ObjectPool()
+		{
+			assert(m_NumObjects == 0 && "Destroy every object before its pool");
+		}
+
+		ObjectPool(const ObjectPool&) = delete;
+		ObjectPool(ObjectPool&&) noexcept = delete;
+		ObjectPool& operator=(const ObjectPool&) = delete;
+		ObjectPool& operator=(ObjectPool&&) noexcept = delete;
+
+		template<typename... Args>
+		T* Create(Args&&... args)
+		{
+			assert(m_pFirstFree && "Object pool is full, give it a bigger capacity");
+			if (!m_pFirstFree)
+				return nullptr;
+
+			Slot* pSlot{ m_pFirstFree };
+			m_pFirstFree = pSlot->pNextFree;
+			++m_NumObjects;
+			return new (pSlot->storage) T(std::forward<Args>(args)...);
+		}
+
+		void Destroy(T* pObject)
+		{
+			if (!pObject)
+				return;
+
+			pObject->~T();
+
+			Slot* pSlot{ reinterpret_cast<Slot*>(pObject) };
+			pSlot->pNextFree = m_pFirstFree;
+			m_pFirstFree = pSlot;
+			--m_NumObjects;
+		}
+
+		size_t GetNumObjects() const { return m_NumObjects; }
+
+	private:
+		union Slot
+		{
+			Slot* pNextFree;
+			alignas(T) std::byte storage[sizeof(T)];
+		};
+
+		std::vector<Slot> m_Slots{};
+		Slot* m_pFirstFree{};
+		size_t m_NumObjects{};
+	};
+}
@@ -0,0 +1,421 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include "MathHelpers.h"
+
+namespace dae
+{
+	namespace Rasterizer
+	{
+		//Screen positions are snapped to a 16.8 fixed point grid, so every test below is exact
+		constexpr int SUBPIXEL_BITS{ 8 };
+		constexpr int SUBPIXEL_ONE{ 1 << SUBPIXEL_BITS };
+		constexpr int SUBPIXEL_HALF{ SUBPIXEL_ONE / 2 };
+
+		inline int ToFixed(float value)
+		{
+			return static_cast<int>(lroundf(value * SUBPIXEL_ONE));
+		}
+
+		//Multisampling: where the samples of a pixel lie relative to its center, in 1/16 pixel.
+		//The standard patterns, with no two samples in the same row or column.
+		constexpr int MAX_SAMPLES{ 4 };
+		constexpr Int2 SAMPLE_OFFSETS_1X[1]{ { 0, 0 } };
+		constexpr Int2 SAMPLE_OFFSETS_2X[2]{ { 4, 4 }, { -4, -4 } };
+		constexpr Int2 SAMPLE_OFFSETS_4X[4]{ { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+
+		inline const Int2* GetSampleOffsets(int sampleCount)
+		{
+			switch (sampleCount)
+			{
+			case 2: return SAMPLE_OFFSETS_2X;
+			case 4: return SAMPLE_OFFSETS_4X;
+			default: return SAMPLE_OFFSETS_1X;
+			}
+		}
+
+		//How far the samples lie from the pixel center in fixed point, on either axis
+		inline int GetSampleReach(int sampleCount)
+		{
+			int reach{};
+			for (int sample{ 0 }; sample < sampleCount; ++sample)
+				reach = std::max({ reach, std::abs(GetSampleOffsets(sampleCount)[sample].x), std::abs(GetSampleOffsets(sampleCount)[sample].y) });
+			return reach * SUBPIXEL_ONE / 16;
+		}
+
+		//Triangles can reach this far past the screen edges without getting clipped. Positions stay below 2^22
+		//in fixed point, so the edge functions never come close to overflowing their 64 bits.
+		constexpr int GUARD_BAND_PIXELS{ 8192 };
+
+		//Large triangles are first tested against square blocks of pixels before going per pixel
+		constexpr int BLOCK_SIZE{ 8 };
+
+		//Fixed point position of the center of a pixel
+		inline int PixelCenter(int pixel)
+		{
+			return (pixel << SUBPIXEL_BITS) + SUBPIXEL_HALF;
+		}
+
+		//Instruction sets the raster loop is written for, from slowest to fastest
+		enum Kernel
+		{
+			SCALAR,
+			SSE2, //4 pixels wide
+			AVX2  //8 pixels wide
+		};
+
+		inline const char* GetKernelName(Kernel kernel)
+		{
+			switch (kernel)
+			{
+			case SSE2: return "SSE2";
+			case AVX2: return "AVX2";
+			default: return "SCALAR";
+			}
+		}
+
+		//What a kernel does with the pixels that pass the depth test
+		enum Pass
+		{
+			COLOR_PASS, //Writes depth and shades
+			DEPTH_PASS, //Only writes depth, nothing but depth gets interpolated
+			EQUAL_DEPTH_PASS //Shades where the depth is exactly the stored depth, after a depth pass laid it down
+		};
+
+		//MSVC and GCC/Clang spell cpuid and xgetbv differently
+		inline void GetCpuInfo(int cpuInfo[4], int function, int subFunction = 0)
+		{
+#ifdef _MSC_VER
+			__cpuidex(cpuInfo, function, subFunction);
+#else
+			__cpuid_count(function, subFunction, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
+#endif
+		}
+
+		inline uint64_t GetEnabledRegisterState()
+		{
+#ifdef _MSC_VER
+			return _xgetbv(0);
+#else
+			uint32_t low{}, high{};
+			__asm__("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+			return (uint64_t(high) << 32) | low;
+#endif
+		}
+
+		inline Kernel GetBestSupportedKernel()
+		{
+			int cpuInfo[4]{};
+			GetCpuInfo(cpuInfo, 0);
+			const int highestFunction{ cpuInfo[0] };
+
+			GetCpuInfo(cpuInfo, 1);
+			const bool hasSSE2{ (cpuInfo[3] & (1 << 26)) != 0 };
+			const bool hasOSXSAVE{ (cpuInfo[2] & (1 << 27)) != 0 };
+			const bool hasAVX{ (cpuInfo[2] & (1 << 28)) != 0 };
+
+			//AVX registers are only usable when the OS saves them on a context switch
+			if (highestFunction >= 7 && hasOSXSAVE && hasAVX && (GetEnabledRegisterState() & 0x6) == 0x6)
+			{
+				GetCpuInfo(cpuInfo, 7);
+				if (cpuInfo[1] & (1 << 5))
+					return AVX2;
+			}
+
+			return hasSSE2 ? SSE2 : SCALAR;
+		}
+
+		struct PixelBounds
+		{
+			Int2 min{}; //Inclusive
+			Int2 max{}; //Exclusive
+		};
+
+		//What a raster kernel did, summed over all the blocks it rasterized
+		struct RasterCounts
+		{
+			int coveredPixels{}; //Passed the coverage test
+			int shadedPixels{}; //Pixel shader invocations
+
+			RasterCounts& operator+=(const RasterCounts& other)
+			{
+				coveredPixels += other.coveredPixels;
+				shadedPixels += other.shadedPixels;
+				return *this;
+			}
+		};
+
+		enum BlockCoverage
+		{
+			OUTSIDE,
+			PARTIAL,
+			INSIDE
+		};
+
+		//E(p) = Cross(v1 - v0, p - v0), positive on the inside of a triangle that is clockwise on screen (y pointing down)
+		struct EdgeFunction
+		{
+			int64_t a{};
+			int64_t b{};
+			int64_t c{};
+			int64_t bias{}; //Top-left fill rule: pixels exactly on the edge only belong to top and left edges
+
+			void Setup(const Int2& v0, const Int2& v1)
+			{
+				a = int64_t(v0.y) - v1.y;
+				b = int64_t(v1.x) - v0.x;
+				c = -a * v0.x - b * v0.y;
+
+				//Screen y points down, so a left edge goes up and a top edge is flat and goes right
+				const bool isTopLeft{ a > 0 || (a == 0 && b > 0) };
+				bias = isTopLeft ? 0 : -1;
+			}
+
+			int64_t Evaluate(int x, int y) const
+			{
+				return a * x + b * y + c;
+			}
+
+			//An edge function is linear, so its extremes over a block lie on the corner pixel centers. Bias included.
+			int64_t MinOverBlock(const PixelBounds& block) const
+			{
+				const int x{ PixelCenter(a >= 0 ? block.min.x : block.max.x - 1) };
+				const int y{ PixelCenter(b >= 0 ? block.min.y : block.max.y - 1) };
+				return Evaluate(x, y) + bias;
+			}
+
+			int64_t MaxOverBlock(const PixelBounds& block) const
+			{
+				const int x{ PixelCenter(a >= 0 ? block.max.x - 1 : block.min.x) };
+				const int y{ PixelCenter(b >= 0 ? block.max.y - 1 : block.min.y) };
+				return Evaluate(x, y) + bias;
+			}
+
+			//Change of the edge function when moving one whole pixel
+			int64_t StepX() const { return a << SUBPIXEL_BITS; }
+			int64_t StepY() const { return b << SUBPIXEL_BITS; }
+		};
+
+		//Twice the signed area, positive for triangles that are clockwise on screen and zero for degenerate ones
+		inline int64_t GetDoubleArea(const Int2& v0, const Int2& v1, const Int2& v2)
+		{
+			return (int64_t(v1.x) - v0.x) * (int64_t(v2.y) - v0.y) - (int64_t(v1.y) - v0.y) * (int64_t(v2.x) - v0.x);
+		}
+
+		//Triangles with a bounding box of at most this many pixels get every pixel center tested during setup
+		constexpr int SMALL_TRIANGLE_PIXELS{ 4 };
+
+		//A value that is linear in screen space, set up once per triangle so a pixel only has to step it
+		struct PlaneEquation
+		{
+			float value{}; //At the center of the first pixel of the triangle's bounds
+			float stepX{}; //Change when moving one whole pixel
+			float stepY{};
+
+			//Offsets are in whole pixels from the first pixel of the triangle's bounds
+			float Evaluate(int offsetX, int offsetY) const
+			{
+				return value + stepX * offsetX + stepY * offsetY;
+			}
+
+			bool operator==(const PlaneEquation& other) const = default;
+		};
+
+		struct Triangle
+		{
+			uint32_t vertexIndices[3]{};
+			EdgeFunction edges[3]{}; //edges[i] is the edge opposite of vertex i, which makes it the unnormalized weight of vertex i
+			float invDoubleArea{};
+			uint32_t minDepthKey{}; //Depth key of the nearest vertex, nothing on the triangle is nearer
+			PlaneEquation depth{}; //NDC depth is linear in screen space, it doesn't need the perspective correction the attributes need
+			PixelBounds bounds{};
+			int sampleReach{}; //Fixed point, how far from the pixel centers the coverage gets tested
+
+			//Only valid after Setup. The weights of vertex 1 and 2 are linear, the weight of vertex 0 is whatever is left of 1.
+			PlaneEquation SetupPlane(float value0, float value1, float value2) const
+			{
+				const float delta1{ value1 - value0 };
+				const float delta2{ value2 - value0 };
+
+				const int x{ PixelCenter(bounds.min.x) };
+				const int y{ PixelCenter(bounds.min.y) };
+				const float weight1{ static_cast<float>(edges[1].Evaluate(x, y)) * invDoubleArea };
+				const float weight2{ static_cast<float>(edges[2].Evaluate(x, y)) * invDoubleArea };
+
+				PlaneEquation plane{};
+				plane.value = value0 + delta1 * weight1 + delta2 * weight2;
+				plane.stepX = (delta1 * static_cast<float>(edges[1].StepX()) + delta2 * static_cast<float>(edges[2].StepX())) * invDoubleArea;
+				plane.stepY = (delta1 * static_cast<float>(edges[1].StepY()) + delta2 * static_cast<float>(edges[2].StepY())) * invDoubleArea;
+				return plane;
+			}
+
+			//Only takes clockwise triangles, returns false when the triangle doesn't cover any pixel center.
+			//With multisampling the samples can lie up to sampleReach away from the centers, the bounds and block tests grow to match.
+			bool Setup(const Int2& v0, const Int2& v1, const Int2& v2, int width, int height, int reach = 0)
+			{
+				const int64_t doubleArea{ GetDoubleArea(v0, v1, v2) };
+				if (doubleArea <= 0)
+					return false;
+
+				edges[0].Setup(v1, v2);
+				edges[1].Setup(v2, v0);
+				edges[2].Setup(v0, v1);
+
+				invDoubleArea = 1.f / static_cast<float>(doubleArea);
+				sampleReach = reach;
+
+				//Only the pixels with a sample inside the fixed point bounding box can be covered
+				const int minX{ std::min(v0.x, std::min(v1.x, v2.x)) };
+				const int minY{ std::min(v0.y, std::min(v1.y, v2.y)) };
+				const int maxX{ std::max(v0.x, std::max(v1.x, v2.x)) };
+				const int maxY{ std::max(v0.y, std::max(v1.y, v2.y)) };
+
+				bounds.min.x = std::max((minX - SUBPIXEL_HALF - reach + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS, 0);
+				bounds.min.y = std::max((minY - SUBPIXEL_HALF - reach + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS, 0);
+				bounds.max.x = std::min(((maxX - SUBPIXEL_HALF + reach) >> SUBPIXEL_BITS) + 1, width);
+				bounds.max.y = std::min(((maxY - SUBPIXEL_HALF + reach) >> SUBPIXEL_BITS) + 1, height);
+
+				if (bounds.min.x >= bounds.max.x || bounds.min.y >= bounds.max.y)
+					return false;
+
+				//Tiny triangles often slip in between the pixel centers of their bounding box.
+				//Between the samples too, but those the kernel finds out about.
+				if ((bounds.max.x - bounds.min.x) * (bounds.max.y - bounds.min.y) > SMALL_TRIANGLE_PIXELS || reach > 0)
+					return true;
+
+				for (int py{ bounds.min.y }; py < bounds.max.y; ++py)
+				{
+					for (int px{ bounds.min.x }; px < bounds.max.x; ++px)
+					{
+						if (TestBlock({ { px, py }, { px + 1, py + 1 } }) != OUTSIDE)
+							return true;
+					}
+				}
+
+				return false;
+			}
+
+			BlockCoverage TestBlock(const PixelBounds& block) const
+			{
+				bool isInside{ true };
+				for (const EdgeFunction& edge : edges)
+				{
+					//The samples can be sampleReach further along both axes than the pixel centers
+					const int64_t sampleSlack{ (std::abs(edge.a) + std::abs(edge.b)) * sampleReach };
+					if (edge.MaxOverBlock(block) + sampleSlack < 0)
+						return OUTSIDE;
+
+					isInside &= edge.MinOverBlock(block) - sampleSlack >= 0;
+				}
+
+				return isInside ? INSIDE : PARTIAL;
+			}
+		};
+
+		//Which of 4 pixels next to each other the triangle covers, one bit per pixel, for the SSE2 kernel.
+		//The edge functions don't fit in 32 bits, so every edge needs two registers of two 64 bit lanes.
+		struct LaneCoverage4
+		{
+			__m128i edgeStepsLow[3]{}; //Pixels 0 and 1
+			__m128i edgeStepsHigh[3]{}; //Pixels 2 and 3
+
+			void Setup(const Triangle& triangle)
+			{
+				for (int edge{ 0 }; edge < 3; ++edge)
+				{
+					const int64_t step{ triangle.edges[edge].StepX() };
+					edgeStepsLow[edge] = _mm_set_epi64x(step, 0);
+					edgeStepsHigh[edge] = _mm_set_epi64x(3 * step, 2 * step);
+				}
+			}
+
+			//Takes the edge functions of the first pixel, bias included. A pixel is outside when any of its edge functions is negative.
+			int GetMask(int64_t edgeWeight0, int64_t edgeWeight1, int64_t edgeWeight2) const
+			{
+				const __m128i weight0{ _mm_set1_epi64x(edgeWeight0) };
+				const __m128i weight1{ _mm_set1_epi64x(edgeWeight1) };
+				const __m128i weight2{ _mm_set1_epi64x(edgeWeight2) };
+				const __m128i outsideLow{ _mm_or_si128(_mm_or_si128(
+					_mm_add_epi64(weight0, edgeStepsLow[0]),
+					_mm_add_epi64(weight1, edgeStepsLow[1])),
+					_mm_add_epi64(weight2, edgeStepsLow[2])) };
+				const __m128i outsideHigh{ _mm_or_si128(_mm_or_si128(
+					_mm_add_epi64(weight0, edgeStepsHigh[0]),
+					_mm_add_epi64(weight1, edgeStepsHigh[1])),
+					_mm_add_epi64(weight2, edgeStepsHigh[2])) };
+
+				const int outsideMask{ _mm_movemask_pd(_mm_castsi128_pd(outsideLow)) | (_mm_movemask_pd(_mm_castsi128_pd(outsideHigh)) << 2) };
+				return ~outsideMask & 0xF;
+			}
+		};
+
+		//The same for 8 pixels and the AVX2 kernel, two registers of four 64 bit lanes per edge
+		struct LaneCoverage8
+		{
+			__m256i edgeStepsLow[3]{}; //Pixels 0 to 3
+			__m256i edgeStepsHigh[3]{}; //Pixels 4 to 7
+
+			void Setup(const Triangle& triangle)
+			{
+				for (int edge{ 0 }; edge < 3; ++edge)
+				{
+					const int64_t step{ triangle.edges[edge].StepX() };
+					edgeStepsLow[edge] = _mm256_setr_epi64x(0, step, 2 * step, 3 * step);
+					edgeStepsHigh[edge] = _mm256_setr_epi64x(4 * step, 5 * step, 6 * step, 7 * step);
+				}
+			}
+
+			int GetMask(int64_t edgeWeight0, int64_t edgeWeight1, int64_t edgeWeight2) const
+			{
+				const __m256i weight0{ _mm256_set1_epi64x(edgeWeight0) };
+				const __m256i weight1{ _mm256_set1_epi64x(edgeWeight1) };
+				const __m256i weight2{ _mm256_set1_epi64x(edgeWeight2) };
+				const __m256i outsideLow{ _mm256_or_si256(_mm256_or_si256(
+					_mm256_add_epi64(weight0, edgeStepsLow[0]),
+					_mm256_add_epi64(weight1, edgeStepsLow[1])),
+					_mm256_add_epi64(weight2, edgeStepsLow[2])) };
+				const __m256i outsideHigh{ _mm256_or_si256(_mm256_or_si256(
+					_mm256_add_epi64(weight0, edgeStepsHigh[0]),
+					_mm256_add_epi64(weight1, edgeStepsHigh[1])),
+					_mm256_add_epi64(weight2, edgeStepsHigh[2])) };
+
+				const int outsideMask{ _mm256_movemask_pd(_mm256_castsi256_pd(outsideLow)) | (_mm256_movemask_pd(_mm256_castsi256_pd(outsideHigh)) << 4) };
+				return ~outsideMask & 0xFF;
+			}
+		};
+
+		//Calls rasterizeBlock(block, isFullyCovered) for every block of the bounds the triangle touches and isOccluded(block) lets through.
+		//Small triangles are rasterized in one go, the block tests would cost more than they save.
+		template<typename IsOccluded, typename RasterizeBlock>
+		RasterCounts WalkBlocks(const Triangle& triangle, const PixelBounds& bounds, IsOccluded&& isOccluded, RasterizeBlock&& rasterizeBlock)
+		{
+			const bool isLarge{ bounds.max.x - bounds.min.x > BLOCK_SIZE || bounds.max.y - bounds.min.y > BLOCK_SIZE };
+			if (!isLarge)
+				return rasterizeBlock(bounds, false);
+
+			RasterCounts counts{};
+			for (int blockY{ bounds.min.y - bounds.min.y % BLOCK_SIZE }; blockY < bounds.max.y; blockY += BLOCK_SIZE)
+			{
+				for (int blockX{ bounds.min.x - bounds.min.x % BLOCK_SIZE }; blockX < bounds.max.x; blockX += BLOCK_SIZE)
+				{
+					PixelBounds block{};
+					block.min = { std::max(blockX, bounds.min.x), std::max(blockY, bounds.min.y) };
+					block.max = { std::min(blockX + BLOCK_SIZE, bounds.max.x), std::min(blockY + BLOCK_SIZE, bounds.max.y) };
+
+					const BlockCoverage coverage{ triangle.TestBlock(block) };
+					if (coverage != OUTSIDE && !isOccluded(block))
+						counts += rasterizeBlock(block, coverage == INSIDE);
+				}
+			}
+
+			return counts;
+		}
+	}
+}
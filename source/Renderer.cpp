@@ -3,6 +3,14 @@
 #include "Renderer.h"
 #include "EffectTransparent.h"
 #include "EffectPosTex.h"
+#include "ThreadPool.h"
+#include "HiZBuffer.h"
+#include "Clipper.h"
+#include "AllocationCounter.h"
+#include "SimdMath.h"
+
+#include <bit>
+#include <immintrin.h>
 
 namespace dae {
 
@@ -37,12 +45,11 @@ namespace dae {
 		std::cout << "\033[1;33m[Key Bindings - SHARED]\033[0m" << std::endl;
 		std::cout << "   \033[1;33m[F1]  Toggle Rasterizer Mode (HARDWARE/SOFTWARE)\033[0m" << std::endl;
 		std::cout << "   \033[1;33m[F2]  Toggle Vehicle Rotation (ON/OFF)\033[0m" << std::endl;
-		//std::cout << "   \033[1;33m[F9]  Cycle CullMode (BACK/FRONT/NONE)\033[0m" << std::endl;
+		std::cout << "   \033[1;33m[F3]  Toggle FireFX (ON/OFF)\033[0m" << std::endl;
 		std::cout << "   \033[1;33m[F10] Toggle Uniform ClearColor (ON/OFF)\033[0m" << std::endl;
 		std::cout << "   \033[1;33m[F11] Toggle Print FPS (ON/OFF)\033[0m" << std::endl;
 		std::cout << std::endl;
 		std::cout << "\033[1;32m[Key Bindings - HARDWARE]\033[0m" << std::endl;
-		std::cout << "   \033[1;32m[F3] Toggle FireFX (ON/OFF)\033[0m" << std::endl;
 		std::cout << "   \033[1;32m[F4] Cycle Sampler State (POINT/LINEAR/ANISOTROPIC)\033[0m" << std::endl;
 		std::cout << std::endl;
 		std::cout << "\033[1;35m[Key Bindings - SOFTWARE]\033[0m" << std::endl;
@@ -50,6 +57,16 @@ namespace dae {
 		std::cout << "   \033[1;35m[F6] Toggle NormalMap (ON/OFF)\033[0m" << std::endl;
 		std::cout << "   \033[1;35m[F7] Toggle DepthBuffer Visualization (ON/OFF)\033[0m" << std::endl;
 		std::cout << "   \033[1;35m[F8] Toggle BoundingBox Visualization (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[F9] Cycle CullMode (BACK/FRONT/NONE)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[V]  Toggle Visibility Buffer (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[Z]  Cycle Depth Format (D32_FLOAT/D24_UNORM/D16_UNORM/D32_FLOAT_REVERSED)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[C]  Toggle Depth Compression (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[P]  Toggle Z-Prepass (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[M]  Cycle MSAA (1X/2X/4X)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[B]  Toggle 8 Wide Shading (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[F]  Toggle Fast Math, 8 wide shading only (ON/OFF)\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[R]  Report Fast Math Error, COMBINED shading with AVX2 8 wide shading only\033[0m" << std::endl;
+		std::cout << "   \033[1;35m[T]  Cycle Texture Layout (LINEAR/MORTON)\033[0m" << std::endl;
 	}
 
 	Renderer::~Renderer()
@@ -67,368 +84,2141 @@ namespace dae {
 		}
 		m_pDevice->Release();
 
-		delete m_pVehicleMesh;
-		delete m_pFireMesh;
-		delete m_pCamera;
-		delete m_pDiffuseTexture;
-		delete m_pGlossTexture;
-		delete m_pNormalTexture;
-		delete m_pSpecularTexture;
+		m_MeshPool.Destroy(m_pVehicleMesh);
+		m_MeshPool.Destroy(m_pFireMesh);
+		m_PosTexEffectPool.Destroy(m_pVehicleEffect);
+		m_TransparentEffectPool.Destroy(m_pFireEffect);
+		delete m_pCamera;
+		m_TexturePool.Destroy(m_pDiffuseTexture);
+		m_TexturePool.Destroy(m_pGlossTexture);
+		m_TexturePool.Destroy(m_pNormalTexture);
+		m_TexturePool.Destroy(m_pSpecularTexture);
+
+		//Software
+		m_TexturePool.Destroy(m_pTexture);
+		m_TexturePool.Destroy(m_pNormalMap);
+		m_TexturePool.Destroy(m_pGlossinessMap);
+		m_TexturePool.Destroy(m_pSpecularMap);
+		m_TexturePool.Destroy(m_pFireTexture);
+		delete[] m_pColorBuffer;
+		delete[] m_pDepthBuffer;
+		delete[] m_pVisibilityBuffer;
+		delete[] m_pIsSampleUniform;
+		delete m_pThreadPool;
+		delete m_pHiZBuffer;
+		delete m_pCompressedDepth;
+		delete m_pFrameArena;
+
+
+	}
+
+	void Renderer::Update(const Timer* pTimer)
+	{
+		m_pCamera->Update(pTimer);
+		m_pVehicleMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+		m_pFireMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+		m_pFireMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+		if (m_DoesRotate)
+		{
+			constexpr float rotationSpeed{ 45.f };
+			m_pVehicleMesh->RotateY(TO_RADIANS * rotationSpeed * pTimer->GetElapsed());
+			m_pFireMesh->RotateY(TO_RADIANS * rotationSpeed * pTimer->GetElapsed());
+			
+		}
+
+	}
+
+	void Renderer::InitializeDX()
+	{
+		//------------
+		//  VEHICLE
+		//------------
+		const auto pEffect = m_PosTexEffectPool.Create(m_pDevice, L"Effects/effect.fx"); //Kept in m_pVehicleEffect, the mesh only uses it
+		m_pVehicleEffect = pEffect;
+		const auto pSpecularTexture = m_TexturePool.Create("Resources/vehicle_specular.png", m_pDevice, Texture::Specular);
+		const auto pGlossTexture = m_TexturePool.Create("Resources/vehicle_gloss.png", m_pDevice, Texture::Gloss);
+		const auto pNormalTexture = m_TexturePool.Create("Resources/vehicle_normal.png", m_pDevice, Texture::Normal);
+		const auto pDiffuseTexture = m_TexturePool.Create("Resources/vehicle_diffuse.png", m_pDevice, Texture::Diffuse);
+
+		m_pVehicleMesh = m_MeshPool.Create(m_pDevice, pEffect, "Resources/vehicle.obj");
+		m_pVehicleMesh->InitializeMeshMatrices({ 0,0,50 }, { 0, PI_DIV_2,0 }, { 1,1,1 });
+		m_pVehicleMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+		pEffect->SetTexture(pDiffuseTexture, Texture::Diffuse);
+		pEffect->SetTexture(pGlossTexture, Texture::Gloss);
+		pEffect->SetTexture(pNormalTexture, Texture::Normal);
+		pEffect->SetTexture(pSpecularTexture, Texture::Specular);
+
+		//------------
+		//   FLAME	  
+		//------------ 
+		const auto pTransparentEffect = m_TransparentEffectPool.Create(m_pDevice, L"Effects/transparency.fx");
+		m_pFireEffect = pTransparentEffect;
+		const auto pFireDiffuseTexture = m_TexturePool.Create("Resources/fireFX_diffuse.png", m_pDevice, Texture::Diffuse);
+		pTransparentEffect->SetTexture(pFireDiffuseTexture, Texture::Diffuse);
+		m_pFireMesh = m_MeshPool.Create(m_pDevice, pTransparentEffect, "Resources/fireFX.obj");
+		m_pFireMesh->InitializeMeshMatrices({ 0,0,50 }, { 0, PI_DIV_2,0 }, { 1,1,1 });
+		m_pFireMesh->SetCullMode(Mesh::NONE); //Same as transparency.fx
+
+		//Delete the temporary textures
+		m_TexturePool.Destroy(pFireDiffuseTexture);
+		m_TexturePool.Destroy(pSpecularTexture);
+		m_TexturePool.Destroy(pGlossTexture);
+		m_TexturePool.Destroy(pNormalTexture);
+		m_TexturePool.Destroy(pDiffuseTexture);
+	}
+
+	void Renderer::InitializeSoftware()
+	{
+		SDL_GetWindowSize(m_pWindow, &m_Width, &m_Height);
+
+		//Create Buffers
+		m_pFrontBuffer = SDL_GetWindowSurface(m_pWindow);
+		m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
+		m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+
+		//The render targets are tiled, the back buffer only gets written when a tile gets resolved
+		m_TiledLayout = TiledLayout{ m_Width, m_Height };
+		m_pColorBuffer = new uint32_t[m_TiledLayout.GetNumPixels() * Rasterizer::MAX_SAMPLES];
+
+		//Big enough for the widest format, switching formats never reallocates. Every tile gets cleared before it is read.
+		size_t maxBytesPerPixel{};
+		for (int format{ 0 }; format < Depth::NUM_FORMATS; ++format)
+			maxBytesPerPixel = std::max(maxBytesPerPixel, Depth::GetBytesPerPixel(static_cast<Depth::Format>(format)));
+		m_pDepthBuffer = new std::byte[m_TiledLayout.GetNumPixels() * maxBytesPerPixel * Rasterizer::MAX_SAMPLES];
+
+		m_pCompressedDepth = new CompressedDepth(m_Width, m_Height);
+		m_pHiZBuffer = new HiZBuffer(m_pDepthBuffer, m_pCompressedDepth, m_DepthFormat, m_Width, m_Height);
+		SetDepthFormat(m_DepthFormat);
+		SetSampleCount(m_SampleCount);
+		m_NumBlocksX = (m_Width + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE;
+		m_pIsSampleUniform = new uint8_t[m_NumBlocksX * ((m_Height + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE)]{};
+		m_pVisibilityBuffer = new uint32_t[m_TiledLayout.GetNumPixels()];
+
+		//The guard band in NDC, 1 being the screen edge
+		m_GuardBand = { 1.f + 2.f * Rasterizer::GUARD_BAND_PIXELS / m_Width, 1.f + 2.f * Rasterizer::GUARD_BAND_PIXELS / m_Height };
+
+		m_AspectRatio = float(m_Width) / float(m_Height);
+
+		m_NumTilesX = m_TiledLayout.numTilesX;
+		m_NumTilesY = m_TiledLayout.numTilesY;
+		m_TileBins.resize(m_NumTilesX * m_NumTilesY);
+		m_TileClearStates.resize(m_NumTilesX * m_NumTilesY);
+
+		//The vehicle needs about 1.5 MB once the lists know their size, the first frame more since they still grow by doubling.
+		//Running out is never fatal, the arena grows to fit at the next Reset.
+		constexpr size_t frameArenaBytes{ 4 * 1024 * 1024 };
+		m_pFrameArena = new FrameArena(frameArenaBytes);
+
+		//The thread calling RenderSoftware also rasterizes tiles, so it doesn't need a worker of its own
+		const uint32_t numThreads{ std::max(std::thread::hardware_concurrency(), 1u) - 1 };
+		m_pThreadPool = new ThreadPool(numThreads);
+
+		m_RasterKernel = Rasterizer::GetBestSupportedKernel();
+		std::cout << "\033[1;35m(SOFTWARE) " << numThreads + 1 << " raster threads, " << Rasterizer::GetKernelName(m_RasterKernel) << " raster kernel\033[0m" << std::endl;
+
+		m_pTexture = Texture::LoadFromFile("Resources/vehicle_diffuse.png", m_TexturePool, m_TextureLayout);
+		m_pNormalMap = Texture::LoadFromFile("Resources/vehicle_normal.png", m_TexturePool, m_TextureLayout);
+		m_pGlossinessMap = Texture::LoadFromFile("Resources/vehicle_gloss.png", m_TexturePool, m_TextureLayout);
+		m_pSpecularMap = Texture::LoadFromFile("Resources/vehicle_specular.png", m_TexturePool, m_TextureLayout);
+		m_pFireTexture = Texture::LoadFromFile("Resources/fireFX_diffuse.png", m_TexturePool, m_TextureLayout);
+		m_FireShader.pDiffuseMap = m_pFireTexture;
+	}
+
+	void Renderer::RenderSoftware()
+	{
+		const uint64_t allocationsStart{ AllocationCounter::GetNumAllocations() };
+		SDL_LockSurface(m_pBackBuffer);
+
+		const uint64_t vertexStart{ SDL_GetPerformanceCounter() };
+		VertexTransformationFunction(*m_pVehicleMesh);
+		m_FrameStats.vertexSeconds = static_cast<float>(SDL_GetPerformanceCounter() - vertexStart) / static_cast<float>(SDL_GetPerformanceFrequency());
+
+		//Vertices are shared between triangles now, it's the index list that has to hold whole triangles
+		assert(m_pVehicleMesh->m_Indices.size() % 3 == 0);
+
+		//Sort the triangles in the screen tiles they touch, then let every thread own whole tiles.
+		//Since no two threads ever write the same pixel, the buffers don't need any locking.
+		BinTriangles(*m_pVehicleMesh);
+
+		//The fire goes through the programmable path, it only gets drawn over the resolved tiles
+		if (m_IsUsingFireFX)
+		{
+			m_FireShader.worldViewProjection = m_pFireMesh->worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+			SetupShadedMesh(*m_pFireMesh, m_FireShader, m_FireVertices, m_FireTriangles);
+		}
+
+		m_FrameStats.pixelsRasterized = 0;
+		m_FrameStats.trianglesOccluded = 0;
+		m_FrameStats.pixelsShaded = 0;
+		m_FrameStats.tilesUntouched = 0;
+		m_FrameStats.depthBlocksRaw = 0;
+		m_FrameStats.depthBlocksCleared = 0;
+		m_FrameStats.depthBlocksPlane = 0;
+		m_FrameStats.sampleBlocksUniform = 0;
+		m_FrameStats.sampleBlocksExpanded = 0;
+		const uint64_t rasterStart{ SDL_GetPerformanceCounter() };
+
+		//Mapping the clear color once per frame, clearing itself only flags the tiles
+		const float clearValue{ m_UseUniformBackground ? 0.1f : 0.39f };
+		m_ClearColor = SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(clearValue * 255),
+			static_cast<uint8_t>(clearValue * 255),
+			static_cast<uint8_t>(clearValue * 255));
+		std::fill(m_TileClearStates.begin(), m_TileClearStates.end(), TileClearState{ true, true });
+		m_PixelShader = SelectPixelShader();
+		m_BatchShader = SelectBatchShader();
+
+		m_pThreadPool->ParallelFor(static_cast<uint32_t>(m_TileBins.size()), [&](uint32_t tileIndex)
+			{
+				RenderTile(static_cast<int>(tileIndex));
+			});
+
+		m_pThreadPool->ParallelFor(static_cast<uint32_t>(m_TileBins.size()), [&](uint32_t tileIndex)
+			{
+				ResolveTile(static_cast<int>(tileIndex));
+				if (m_IsUsingFireFX)
+					DrawShadedTile(static_cast<int>(tileIndex), m_FireShader, m_FireTriangles);
+			});
+
+		m_FrameStats.rasterSeconds = static_cast<float>(SDL_GetPerformanceCounter() - rasterStart) / static_cast<float>(SDL_GetPerformanceFrequency());
+		m_FrameStats.heapAllocations = AllocationCounter::GetNumAllocations() - allocationsStart;
+
+		SDL_UnlockSurface(m_pBackBuffer);
+		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
+		SDL_UpdateWindowSurface(m_pWindow);
+	}
+
+	void Renderer::BinTriangles(Mesh& mesh)
+	{
+		//Nothing of last frame is used past this point, so its lists can all go at once
+		m_pFrameArena->Reset();
+		for (auto& bin : m_TileBins)
+			ResetArenaVector(bin);
+
+		ResetArenaVector(m_Triangles);
+		ResetArenaVector(m_TriangleAttributes);
+		m_FrameStats.trianglesInside = 0;
+		m_FrameStats.trianglesInGuardBand = 0;
+		m_FrameStats.trianglesClipped = 0;
+		m_FrameStats.trianglesFrustumCulled = 0;
+		m_FrameStats.trianglesFaceCulled = 0;
+		m_FrameStats.trianglesDegenerate = 0;
+		m_FrameStats.trianglesSmallCulled = 0;
+
+		//Use this for triangle strip, every odd triangle has its first and last vertex swapped.
+		//for (int startVertexIndex{ 0 }; startVertexIndex < m_pVehicleMesh->m_Indices.size() - 2; ++startVertexIndex)
+			//vertexIndex0 = m_Indices[startVertexIndex + 2 * (startVertexIndex % 2)], vertexIndex2 = m_Indices[startVertexIndex + 2 * !(startVertexIndex % 2)]
+		//The reversed depth has no far plane
+		const uint16_t cullPlanes{ static_cast<uint16_t>(m_DepthFormat == Depth::D32_FLOAT_REVERSED ? ~Clipper::CLIP_FAR : ~0) };
+
+		for (int vertexIndex{ 0 }; vertexIndex < mesh.m_Indices.size(); vertexIndex += 3)
+		{
+			const uint32_t vertexIndex0{ mesh.m_Indices[vertexIndex] };
+			const uint32_t vertexIndex1{ mesh.m_Indices[vertexIndex + 1] };
+			const uint32_t vertexIndex2{ mesh.m_Indices[vertexIndex + 2] };
+
+			const uint16_t clipCode0{ mesh.m_VerticesOut.clipCodes[vertexIndex0] };
+			const uint16_t clipCode1{ mesh.m_VerticesOut.clipCodes[vertexIndex1] };
+			const uint16_t clipCode2{ mesh.m_VerticesOut.clipCodes[vertexIndex2] };
+
+			//All vertices on the outside of the same plane, nothing of the triangle can be visible
+			if (clipCode0 & clipCode1 & clipCode2 & cullPlanes)
+			{
+				++m_FrameStats.trianglesFrustumCulled;
+				continue;
+			}
+
+			const uint16_t combinedClipCode{ static_cast<uint16_t>(clipCode0 | clipCode1 | clipCode2) };
+			if (combinedClipCode & (Clipper::CLIP_NEAR | Clipper::GUARD_BAND_PLANES))
+			{
+				++m_FrameStats.trianglesClipped;
+				ClipTriangle(mesh, vertexIndex0, vertexIndex1, vertexIndex2);
+				continue;
+			}
+
+			//Crossing the screen edges is fine, the bounding box gets clamped to the screen anyway
+			if (combinedClipCode & Clipper::VIEWPORT_PLANES)
+				++m_FrameStats.trianglesInGuardBand;
+			else ++m_FrameStats.trianglesInside;
+
+			BinTriangle(mesh, vertexIndex0, vertexIndex1, vertexIndex2);
+		}
+	}
+
+	void Renderer::BinTriangle(const Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2)
+	{
+		//Culling, only the triangles that can cover a pixel make it into the compacted triangle list
+		Rasterizer::Triangle triangle{};
+		switch (SetupTriangle(mesh, vertexIndex0, vertexIndex1, vertexIndex2, triangle))
+		{
+		case SETUP_DEGENERATE:
+			++m_FrameStats.trianglesDegenerate;
+			return;
+		case SETUP_FACE_CULLED:
+			++m_FrameStats.trianglesFaceCulled;
+			return;
+		case SETUP_TOO_SMALL:
+			++m_FrameStats.trianglesSmallCulled;
+			return;
+		default:
+			break;
+		}
+
+		//Triangles are pushed in submission order, so every tile still draws them in that order
+		const uint32_t triangleIndex{ static_cast<uint32_t>(m_Triangles.size()) };
+		m_Triangles.push_back(triangle);
+		m_TriangleAttributes.push_back(SetupAttributes(mesh, triangle));
+
+		const int firstTileX{ triangle.bounds.min.x / TILE_SIZE };
+		const int firstTileY{ triangle.bounds.min.y / TILE_SIZE };
+		const int lastTileX{ (triangle.bounds.max.x - 1) / TILE_SIZE };
+		const int lastTileY{ (triangle.bounds.max.y - 1) / TILE_SIZE };
+
+		for (int tileY{ firstTileY }; tileY <= lastTileY; ++tileY)
+			for (int tileX{ firstTileX }; tileX <= lastTileX; ++tileX)
+				m_TileBins[tileX + tileY * m_NumTilesX].push_back(triangleIndex);
+	}
+
+	template<typename T>
+	void Renderer::ResetArenaVector(ArenaVector<T>& vector) const
+	{
+		const size_t lastSize{ vector.size() };
+		vector = ArenaVector<T>(ArenaAllocator<T>{ m_pFrameArena });
+		vector.reserve(lastSize);
+	}
+
+	void Renderer::ClipTriangle(Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2)
+	{
+		//The new vertices get added to the mesh like any other vertex
+		uint32_t polygon[Clipper::MAX_POLYGON_VERTICES]{ vertexIndex0, vertexIndex1, vertexIndex2 };
+		const int numVertices{ Clipper::ClipPolygon(polygon, 3, m_GuardBand,
+			[&](uint32_t index) { return mesh.m_VerticesOut.clipPositions[index]; },
+			[&](uint32_t insideIndex, uint32_t outsideIndex, float factor) { return AddClippedVertex(mesh, insideIndex, outsideIndex, factor); }) };
+
+		//The polygon is convex, so a fan keeps the winding of the original triangle
+		for (int i{ 1 }; i < numVertices - 1; ++i)
+			BinTriangle(mesh, polygon[0], polygon[i], polygon[i + 1]);
+	}
+
+	uint32_t Renderer::AddClippedVertex(Mesh& mesh, uint32_t insideIndex, uint32_t outsideIndex, float factor)
+	{
+		TransformedVertices& vertices{ mesh.m_VerticesOut };
+
+		//Every attribute is linear in clip space, so a plain lerp is perspective correct here
+		auto lerp = [&](const auto& stream)
+		{
+			return stream[insideIndex] + (stream[outsideIndex] - stream[insideIndex]) * factor;
+		};
+
+		const Vector4 clipPosition{ lerp(vertices.clipPositions) };
+		const Vector2 uv{ lerp(vertices.uvs) };
+		const Vector3 normal{ lerp(vertices.normals) };
+		const Vector3 tangent{ lerp(vertices.tangents) };
+		const Vector3 viewDirection{ lerp(vertices.viewDirections) };
+
+		vertices.clipPositions.push_back(clipPosition);
+		vertices.clipCodes.push_back(Clipper::ComputeClipCode(clipPosition, m_GuardBand));
+		vertices.screenPositions.push_back(ToScreenPosition(clipPosition));
+		vertices.uvs.push_back(uv);
+		vertices.normals.push_back(normal);
+		vertices.tangents.push_back(tangent);
+		vertices.viewDirections.push_back(viewDirection);
+
+		return static_cast<uint32_t>(vertices.Size() - 1);
+	}
+
+	Vector4 Renderer::ToScreenPosition(const Vector4& clipPosition) const
+	{
+		//Perspective divide, then the viewport transform. w stays for the perspective correct interpolation.
+		const float ndcX{ clipPosition.x / clipPosition.w };
+		const float ndcY{ clipPosition.y / clipPosition.w };
+		return { (ndcX + 1) / 2.0f * m_Width, (1.0f - ndcY) / 2.0f * m_Height, GetDepthNumerator(clipPosition.z) / clipPosition.w, clipPosition.w };
+	}
+
+	float Renderer::GetDepthNumerator(float clipZ) const
+	{
+		//A reversed projection with its far plane at infinity leaves near in z, so the depth is near / w.
+		//The camera matrix is shared with the hardware path, so the software path only swaps out z.
+		return m_DepthFormat == Depth::D32_FLOAT_REVERSED ? m_pCamera->nearPlane : clipZ;
+	}
+
+	void Renderer::RenderTile(int tileIndex)
+	{
+		const Rasterizer::PixelBounds tileBounds{ GetTileBounds(tileIndex) };
+
+		//The hierarchical depth is tiny, clearing it for real is cheaper than checking a flag for every test
+		m_pHiZBuffer->Clear(tileBounds, m_ClearDepthKey);
+
+		Rasterizer::RasterCounts counts{};
+		int occludedTriangles{};
+
+		//Depth first, after which only the triangle in front of a pixel passes the equal test, so every pixel gets shaded once.
+		//The hierarchical depth is complete after the depth pass, it throws out everything hidden before the shading pass.
+		if (m_UseZPrepass && m_SampleCount == 1 && m_CurrentRenderMode != BOUNDING_BOX)
+		{
+			DrawTileTriangles<Rasterizer::DEPTH_PASS>(tileIndex, tileBounds, counts, occludedTriangles);
+			DrawTileTriangles<Rasterizer::EQUAL_DEPTH_PASS>(tileIndex, tileBounds, counts, occludedTriangles);
+		}
+		else DrawTileTriangles<Rasterizer::COLOR_PASS>(tileIndex, tileBounds, counts, occludedTriangles);
+
+		//Only the triangle that ended up in front gets shaded, overdraw doesn't cost any shading anymore.
+		//A tile that still has its depth cleared has nothing in its visibility buffer yet.
+		if (IsUsingVisibilityBuffer() && !m_TileClearStates[tileIndex].isDepthCleared)
+			counts.shadedPixels += ShadeVisibleTile(tileBounds);
+
+		m_FrameStats.pixelsRasterized += counts.coveredPixels;
+		m_FrameStats.pixelsShaded += counts.shadedPixels;
+		m_FrameStats.trianglesOccluded += occludedTriangles;
+	}
+
+	template<Rasterizer::Pass pass>
+	void Renderer::DrawTileTriangles(int tileIndex, const Rasterizer::PixelBounds& tileBounds, Rasterizer::RasterCounts& counts, int& occludedTriangles)
+	{
+		for (const uint32_t triangleIndex : m_TileBins[tileIndex])
+		{
+			const Rasterizer::Triangle& triangle{ m_Triangles[triangleIndex] };
+
+			Rasterizer::PixelBounds bounds{};
+			bounds.min = { std::max(triangle.bounds.min.x, tileBounds.min.x), std::max(triangle.bounds.min.y, tileBounds.min.y) };
+			bounds.max = { std::min(triangle.bounds.max.x, tileBounds.max.x), std::min(triangle.bounds.max.y, tileBounds.max.y) };
+
+			//Triangles drawn earlier in this tile might already hide this one completely
+			if (IsOccluded(triangle, bounds))
+			{
+				++occludedTriangles;
+				continue;
+			}
+
+			MaterializeDepth(tileIndex, tileBounds);
+			//Bounding boxes get drawn without a depth test, so the resolve can't tell which pixels they covered
+			if (m_CurrentRenderMode == BOUNDING_BOX)
+				MaterializeColor(tileIndex);
+
+			counts += RenderTriangle<pass>(triangleIndex, triangle, bounds);
+		}
+	}
+
+	Rasterizer::PixelBounds Renderer::GetTileBounds(int tileIndex) const
+	{
+		Rasterizer::PixelBounds tileBounds{};
+		tileBounds.min = { (tileIndex % m_NumTilesX) * TILE_SIZE, (tileIndex / m_NumTilesX) * TILE_SIZE };
+		tileBounds.max = { std::min(tileBounds.min.x + TILE_SIZE, m_Width), std::min(tileBounds.min.y + TILE_SIZE, m_Height) };
+		return tileBounds;
+	}
+
+	void Renderer::MaterializeDepth(int tileIndex, const Rasterizer::PixelBounds& tileBounds)
+	{
+		TileClearState& clearState{ m_TileClearStates[tileIndex] };
+		if (!clearState.isDepthCleared)
+			return;
+
+		//Compressed, the clear is just a state per block
+		if (IsDepthCompressed())
+			m_pCompressedDepth->SetState(tileBounds, CompressedDepth::CLEARED);
+		else
+		{
+			Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+				{
+					using DepthTraits = decltype(depthTraits);
+					for (int sample{ 0 }; sample < m_SampleCount; ++sample)
+						std::fill_n(GetDepthBuffer<DepthTraits>(sample) + GetTileStart(tileIndex), TiledLayout::TILE_PIXELS, DepthTraits::CLEAR_VALUE);
+				});
+			m_pCompressedDepth->SetState(tileBounds, CompressedDepth::RAW);
+		}
+
+		//Every sample of a cleared pixel matches
+		if (m_SampleCount > 1)
+		{
+			for (int blockY{ tileBounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (tileBounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+				for (int blockX{ tileBounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (tileBounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+					m_pIsSampleUniform[blockX + blockY * m_NumBlocksX] = true;
+		}
+
+		if (IsUsingVisibilityBuffer())
+			std::fill_n(m_pVisibilityBuffer + GetTileStart(tileIndex), TiledLayout::TILE_PIXELS, NO_TRIANGLE);
+		clearState.isDepthCleared = false;
+	}
+
+	void Renderer::MaterializeColor(int tileIndex)
+	{
+		TileClearState& clearState{ m_TileClearStates[tileIndex] };
+		if (!clearState.isColorCleared)
+			return;
+
+		std::fill_n(m_pColorBuffer + GetTileStart(tileIndex), TiledLayout::TILE_PIXELS, m_ClearColor);
+		clearState.isColorCleared = false;
+	}
+
+	void Renderer::ResolveTile(int tileIndex)
+	{
+		const TileClearState& clearState{ m_TileClearStates[tileIndex] };
+		const Rasterizer::PixelBounds tileBounds{ GetTileBounds(tileIndex) };
+		if (clearState.isDepthCleared && clearState.isColorCleared)
+		{
+			//Nothing got drawn here at all. Streaming stores skip the cache, nothing is going to read these pixels this frame.
+			const __m128i clearColor{ _mm_set1_epi32(static_cast<int>(m_ClearColor)) };
+			for (int py{ tileBounds.min.y }; py < tileBounds.max.y; ++py)
+			{
+				uint32_t* pPixel{ m_pBackBufferPixels + py * m_Width + tileBounds.min.x };
+				uint32_t* const pRowEnd{ m_pBackBufferPixels + py * m_Width + tileBounds.max.x };
+
+				//The stores need 16 byte alignment, the surface rows don't promise any
+				while (pPixel < pRowEnd && reinterpret_cast<uintptr_t>(pPixel) % sizeof(__m128i) != 0)
+					*pPixel++ = m_ClearColor;
+				for (; pPixel + 4 <= pRowEnd; pPixel += 4)
+					_mm_stream_si128(reinterpret_cast<__m128i*>(pPixel), clearColor);
+				while (pPixel < pRowEnd)
+					*pPixel++ = m_ClearColor;
+			}
+			//Streaming stores aren't ordered with the rest, they have to be done before the surface gets presented
+			_mm_sfence();
+			++m_FrameStats.tilesUntouched;
+			return;
+		}
+
+		//The color of the tile is all there, it only has to go from tiled to linear
+		const int tileWidth{ tileBounds.max.x - tileBounds.min.x };
+		if (!clearState.isColorCleared)
+		{
+			for (int py{ tileBounds.min.y }; py < tileBounds.max.y; ++py)
+				std::copy_n(m_pColorBuffer + m_TiledLayout.GetPixelIndex(tileBounds.min.x, py), tileWidth, m_pBackBufferPixels + py * m_Width + tileBounds.min.x);
+			return;
+		}
+
+		if (m_SampleCount > 1)
+		{
+			ResolveSamples(tileBounds);
+			return;
+		}
+
+		//Every pixel something got drawn in has a depth in front of the clear depth, the rest gets the clear color.
+		//Compressed blocks know without looking: cleared ones are empty, a plane covers all of its block.
+		uint32_t blockCounts[3]{};
+		Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+			{
+				using DepthTraits = decltype(depthTraits);
+				const typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+				for (int blockY{ tileBounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (tileBounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+				{
+					for (int blockX{ tileBounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (tileBounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+					{
+						const CompressedDepth::BlockState state{ m_pCompressedDepth->GetBlock(blockX, blockY).state };
+						++blockCounts[state];
+
+						const Rasterizer::PixelBounds blockBounds{ m_pCompressedDepth->GetBlockBounds(blockX, blockY) };
+						const int blockWidth{ blockBounds.max.x - blockBounds.min.x };
+						for (int py{ blockBounds.min.y }; py < blockBounds.max.y; ++py)
+						{
+							const int tileRow{ m_TiledLayout.GetPixelIndex(blockBounds.min.x, py) };
+							uint32_t* const pSurfaceRow{ m_pBackBufferPixels + py * m_Width + blockBounds.min.x };
+							if (state == CompressedDepth::CLEARED)
+								std::fill_n(pSurfaceRow, blockWidth, m_ClearColor);
+							else if (state == CompressedDepth::PLANE)
+								std::copy_n(m_pColorBuffer + tileRow, blockWidth, pSurfaceRow);
+							else
+							{
+								for (int offset{ 0 }; offset < blockWidth; ++offset)
+									pSurfaceRow[offset] = pDepthBuffer[tileRow + offset] == DepthTraits::CLEAR_VALUE ? m_ClearColor : m_pColorBuffer[tileRow + offset];
+							}
+						}
+					}
+				}
+			});
+
+		m_FrameStats.depthBlocksRaw += blockCounts[CompressedDepth::RAW];
+		m_FrameStats.depthBlocksCleared += blockCounts[CompressedDepth::CLEARED];
+		m_FrameStats.depthBlocksPlane += blockCounts[CompressedDepth::PLANE];
+	}
+
+	void Renderer::ResolveSamples(const Rasterizer::PixelBounds& tileBounds)
+	{
+		const int samplePlane{ m_TiledLayout.GetNumPixels() };
+		uint32_t numUniformBlocks{};
+		uint32_t numExpandedBlocks{};
+		Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+			{
+				using DepthTraits = decltype(depthTraits);
+				const typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+
+				//A sample nothing got drawn in has the clear color, the kernels never store a fragment as far as the clear value
+				auto getSampleColor = [&](int sampleIdx)
+				{
+					return pDepthBuffer[sampleIdx] == DepthTraits::CLEAR_VALUE ? m_ClearColor : m_pColorBuffer[sampleIdx];
+				};
+
+				for (int blockY{ tileBounds.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (tileBounds.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+				{
+					for (int blockX{ tileBounds.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (tileBounds.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+					{
+						//The color samples of a uniform block all match, its first sample is all there is to it.
+						//Its depth samples still differ, but only whether a sample was drawn in matters here and that matches too.
+						const bool isUniform{ m_pIsSampleUniform[blockX + blockY * m_NumBlocksX] != 0 };
+						++(isUniform ? numUniformBlocks : numExpandedBlocks);
+
+						const Rasterizer::PixelBounds blockBounds{ m_pCompressedDepth->GetBlockBounds(blockX, blockY) };
+						for (int py{ blockBounds.min.y }; py < blockBounds.max.y; ++py)
+						{
+							const int tileRow{ m_TiledLayout.GetPixelIndex(blockBounds.min.x, py) };
+							uint32_t* const pSurfaceRow{ m_pBackBufferPixels + py * m_Width + blockBounds.min.x };
+							for (int offset{ 0 }; offset < blockBounds.max.x - blockBounds.min.x; ++offset)
+							{
+								if (isUniform)
+								{
+									pSurfaceRow[offset] = getSampleColor(tileRow + offset);
+									continue;
+								}
+
+								//Box filter, every channel averaged on its own whatever the channel order of the surface is
+								uint32_t channelSums[4]{};
+								for (int sample{ 0 }; sample < m_SampleCount; ++sample)
+								{
+									const uint32_t color{ getSampleColor(sample * samplePlane + tileRow + offset) };
+									for (int channel{ 0 }; channel < 4; ++channel)
+										channelSums[channel] += (color >> (8 * channel)) & 0xFF;
+								}
+
+								uint32_t resolved{};
+								for (int channel{ 0 }; channel < 4; ++channel)
+									resolved |= ((channelSums[channel] + m_SampleCount / 2) / m_SampleCount) << (8 * channel);
+								pSurfaceRow[offset] = resolved;
+							}
+						}
+					}
+				}
+			});
+
+		m_FrameStats.sampleBlocksUniform += numUniformBlocks;
+		m_FrameStats.sampleBlocksExpanded += numExpandedBlocks;
+	}
+
+	int Renderer::ShadeVisibleTile(const Rasterizer::PixelBounds& tileBounds) const
+	{
+		int shadedPixels{};
+		FragmentBatch batch{};
+		for (int py{ tileBounds.min.y }; py < tileBounds.max.y; ++py)
+		{
+			for (int px{ tileBounds.min.x }; px < tileBounds.max.x; ++px)
+			{
+				const uint32_t triangleIndex{ m_pVisibilityBuffer[m_TiledLayout.GetPixelIndex(px, py)] };
+				if (triangleIndex == NO_TRIANGLE)
+					continue;
+
+				//The attribute planes only need the pixel position, the depth is still in the depth buffer
+				AddFragment(batch, triangleIndex, px, py, GetStoredDepth(px, py));
+				++shadedPixels;
+			}
+		}
+		FlushFragments(batch);
+
+		return shadedPixels;
+	}
+
+	Renderer::SetupResult Renderer::SetupTriangle(const Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2, Rasterizer::Triangle& triangle) const
+	{
+		const std::vector<Vector4>& screenPositions{ mesh.m_VerticesOut.screenPositions };
+		return SetupTriangle(screenPositions[vertexIndex0], screenPositions[vertexIndex1], screenPositions[vertexIndex2], mesh.GetCullMode(),
+			vertexIndex0, vertexIndex1, vertexIndex2, triangle);
+	}
+
+	Renderer::SetupResult Renderer::SetupTriangle(Vector4 screenPosition0, Vector4 screenPosition1, Vector4 screenPosition2, Mesh::CullMode cullMode,
+		uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2, Rasterizer::Triangle& triangle) const
+	{
+		// Make sure the triangle doesn't have the same vertex twice. If it does it's got no area so we don't have to render it.
+		if (vertexIndex0 == vertexIndex1 || vertexIndex1 == vertexIndex2 || vertexIndex2 == vertexIndex0)
+			return SETUP_DEGENERATE;
+
+		//Snap to the fixed point grid, shared vertices snap to the exact same spot so shared edges stay watertight
+		Int2 vertex0{ Rasterizer::ToFixed(screenPosition0.x), Rasterizer::ToFixed(screenPosition0.y) };
+		Int2 vertex1{ Rasterizer::ToFixed(screenPosition1.x), Rasterizer::ToFixed(screenPosition1.y) };
+		Int2 vertex2{ Rasterizer::ToFixed(screenPosition2.x), Rasterizer::ToFixed(screenPosition2.y) };
+
+		//The snapped positions decide, so the rasterizer never sees a triangle with the wrong winding or no area
+		const int64_t doubleArea{ Rasterizer::GetDoubleArea(vertex0, vertex1, vertex2) };
+		if (doubleArea == 0)
+			return SETUP_DEGENERATE;
+
+		const bool isFrontFacing{ doubleArea > 0 };
+		if ((cullMode == Mesh::BACK && !isFrontFacing) || (cullMode == Mesh::FRONT && isFrontFacing))
+			return SETUP_FACE_CULLED;
+
+		//The rasterizer only takes clockwise triangles, swapping two vertices keeps every weight with its own vertex
+		if (!isFrontFacing)
+		{
+			std::swap(vertex1, vertex2);
+			std::swap(vertexIndex1, vertexIndex2);
+			std::swap(screenPosition1, screenPosition2);
+		}
+
+		triangle.vertexIndices[0] = vertexIndex0;
+		triangle.vertexIndices[1] = vertexIndex1;
+		triangle.vertexIndices[2] = vertexIndex2;
+
+		//Clamped, a vertex in front of 0 after clipping is still nearer than anything and the unorm keys can't go negative
+		auto toKey = [this](float depth) { return Depth::ToKey(m_DepthFormat, std::clamp(depth, 0.f, 1.f)); };
+		triangle.minDepthKey = std::min({ toKey(screenPosition0.z), toKey(screenPosition1.z), toKey(screenPosition2.z) });
+
+		if (!triangle.Setup(vertex0, vertex1, vertex2, m_Width, m_Height, Rasterizer::GetSampleReach(m_SampleCount)))
+			return SETUP_TOO_SMALL;
+
+		triangle.depth = triangle.SetupPlane(screenPosition0.z, screenPosition1.z, screenPosition2.z);
+
+		return SETUP_DONE;
+	}
+
+	Renderer::TriangleAttributes Renderer::SetupAttributes(const Mesh& mesh, const Rasterizer::Triangle& triangle) const
+	{
+		const TransformedVertices& vertices{ mesh.m_VerticesOut };
+		const uint32_t vertexIndex0{ triangle.vertexIndices[0] };
+		const uint32_t vertexIndex1{ triangle.vertexIndices[1] };
+		const uint32_t vertexIndex2{ triangle.vertexIndices[2] };
+
+		const float invW0{ 1.f / vertices.screenPositions[vertexIndex0].w };
+		const float invW1{ 1.f / vertices.screenPositions[vertexIndex1].w };
+		const float invW2{ 1.f / vertices.screenPositions[vertexIndex2].w };
+
+		auto setupPlane = [&](float value0, float value1, float value2)
+		{
+			return triangle.SetupPlane(value0 * invW0, value1 * invW1, value2 * invW2);
+		};
+
+		TriangleAttributes attributes{};
+		attributes.invW = triangle.SetupPlane(invW0, invW1, invW2);
+		attributes.uv[0] = setupPlane(vertices.uvs[vertexIndex0].x, vertices.uvs[vertexIndex1].x, vertices.uvs[vertexIndex2].x);
+		attributes.uv[1] = setupPlane(vertices.uvs[vertexIndex0].y, vertices.uvs[vertexIndex1].y, vertices.uvs[vertexIndex2].y);
+
+		for (int axis{ 0 }; axis < 3; ++axis)
+		{
+			attributes.normal[axis] = setupPlane(vertices.normals[vertexIndex0][axis], vertices.normals[vertexIndex1][axis], vertices.normals[vertexIndex2][axis]);
+			attributes.tangent[axis] = setupPlane(vertices.tangents[vertexIndex0][axis], vertices.tangents[vertexIndex1][axis], vertices.tangents[vertexIndex2][axis]);
+			attributes.viewDirection[axis] = setupPlane(vertices.viewDirections[vertexIndex0][axis], vertices.viewDirections[vertexIndex1][axis], vertices.viewDirections[vertexIndex2][axis]);
+		}
+
+		return attributes;
+	}
+
+	bool Renderer::IsOccluded(const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		//The interpolated depth always lies between the depths of the vertices
+		return m_UseHiZ && m_pHiZBuffer->IsOccluded(bounds, triangle.minDepthKey);
+	}
+
+	template<Rasterizer::Pass pass>
+	Rasterizer::RasterCounts Renderer::RenderTriangle(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		if (m_CurrentRenderMode == BOUNDING_BOX)
+		{
+			const uint32_t boundingBoxColor{ SDL_MapRGB(m_pBackBuffer->format, 255, 255, 255) };
+			for (int py{ bounds.min.y }; py < bounds.max.y; ++py)
+				std::fill_n(m_pColorBuffer + m_TiledLayout.GetPixelIndex(bounds.min.x, py), bounds.max.x - bounds.min.x, boundingBoxColor);
+
+			return {};
+		}
+
+		return Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+			{
+				using DepthTraits = decltype(depthTraits);
+				if (m_SampleCount == 4)
+					return RasterizeMultisampled<DepthTraits, 4>(triangleIndex, triangle, bounds);
+				if (m_SampleCount == 2)
+					return RasterizeMultisampled<DepthTraits, 2>(triangleIndex, triangle, bounds);
+
+				switch (m_RasterKernel)
+				{
+				case Rasterizer::AVX2:
+					return RasterizeAVX2<DepthTraits, pass>(triangleIndex, triangle, bounds);
+				case Rasterizer::SSE2:
+					return RasterizeSSE2<DepthTraits, pass>(triangleIndex, triangle, bounds);
+				default:
+					return RasterizeScalar<DepthTraits, pass>(triangleIndex, triangle, bounds);
+				}
+			});
+	}
+
+	template<typename DepthTraits, Rasterizer::Pass pass>
+	bool Renderer::DrawDepthPlane(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& block, Rasterizer::RasterCounts& counts) const
+	{
+		//Only a whole block can become a plane
+		const int blockX{ block.min.x / Rasterizer::BLOCK_SIZE };
+		const int blockY{ block.min.y / Rasterizer::BLOCK_SIZE };
+		const Rasterizer::PixelBounds blockBounds{ m_pCompressedDepth->GetBlockBounds(blockX, blockY) };
+		if (block.min.x != blockBounds.min.x || block.min.y != blockBounds.min.y || block.max.x != blockBounds.max.x || block.max.y != blockBounds.max.y)
+			return false;
+
+		const CompressedDepth::Block& stored{ m_pCompressedDepth->GetBlock(blockX, blockY) };
+		if (stored.state == CompressedDepth::RAW)
+			return false;
+
+		CompressedDepth::Block plane{};
+		plane.plane = triangle.depth;
+		plane.origin = triangle.bounds.min;
+
+		//Both depths are planes, so when the triangle is in front in all four corners it is in front everywhere in between
+		const uint32_t clearKey{ DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE) };
+		const int lastX{ block.max.x - 1 };
+		const int lastY{ block.max.y - 1 };
+		for (const Int2& corner : { block.min, Int2{ lastX, block.min.y }, Int2{ block.min.x, lastY }, Int2{ lastX, lastY } })
+		{
+			const float depth{ plane.GetDepth(corner.x, corner.y) };
+			if (depth < 0.f || depth > 1.f)
+				return false;
+
+			//A corner as far as the clear value goes to the kernels, they leave that pixel empty
+			const uint32_t storedKey{ stored.state == CompressedDepth::CLEARED ? clearKey : DepthTraits::ToKey(stored.GetDepth(corner.x, corner.y)) };
+			const uint32_t depthKey{ DepthTraits::ToKey(depth) };
+			if (depthKey > storedKey || depthKey == clearKey)
+				return false;
+		}
+
+		m_pCompressedDepth->SetPlane(blockX, blockY, triangle, triangleIndex);
+		m_pHiZBuffer->MarkDirty(block);
+
+		counts.coveredPixels += (block.max.x - block.min.x) * (block.max.y - block.min.y);
+		if constexpr (pass == Rasterizer::COLOR_PASS)
+			ShadeDepthPlane<DepthTraits>(triangleIndex, triangle, block, plane, counts);
+		return true;
+	}
+
+	template<typename DepthTraits>
+	void Renderer::ShadeDepthPlane(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& block, const CompressedDepth::Block& plane, Rasterizer::RasterCounts& counts) const
+	{
+		if (IsUsingVisibilityBuffer())
+		{
+			for (int py{ block.min.y }; py < block.max.y; ++py)
+				std::fill_n(m_pVisibilityBuffer + m_TiledLayout.GetPixelIndex(block.min.x, py), block.max.x - block.min.x, triangleIndex);
+			return;
+		}
+
+		counts.shadedPixels += (block.max.x - block.min.x) * (block.max.y - block.min.y);
+		const TriangleAttributes& attributes{ m_TriangleAttributes[triangleIndex] };
+		for (int py{ block.min.y }; py < block.max.y; ++py)
+		{
+			for (int px{ block.min.x }; px < block.max.x; ++px)
+			{
+				ShadeFragment(triangle, attributes, px, py, DepthTraits::ToDepth(DepthTraits::ToKey(plane.GetDepth(px, py))));
+			}
+		}
+	}
+
+	template<typename DepthTraits, Rasterizer::Pass pass, typename RasterizeBlock>
+	Rasterizer::RasterCounts Renderer::WalkTriangle(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds, RasterizeBlock&& rasterizeBlock) const
+	{
+		auto isOccluded = [&](const Rasterizer::PixelBounds& block) { return IsOccluded(triangle, block); };
+		if constexpr (pass == Rasterizer::EQUAL_DEPTH_PASS)
+		{
+			//Decompressing would store depths that aren't exactly what the kernels compute, so the equal test only runs on raw blocks.
+			//A cleared block has nothing visible in it. A plane only shows the triangle it came from: that one covered all of the block,
+			//and anything in front of it after that would have replaced the plane or decompressed the block. The plane keeps the index
+			//of that triangle, a coplanar neighbour with the same bounds origin would otherwise shade the block a second time.
+			if (IsDepthCompressed())
+			{
+				auto rasterizeCompressed = [&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+				{
+					Rasterizer::RasterCounts counts{};
+					for (int blockY{ block.min.y / Rasterizer::BLOCK_SIZE }; blockY <= (block.max.y - 1) / Rasterizer::BLOCK_SIZE; ++blockY)
+					{
+						for (int blockX{ block.min.x / Rasterizer::BLOCK_SIZE }; blockX <= (block.max.x - 1) / Rasterizer::BLOCK_SIZE; ++blockX)
+						{
+							const Rasterizer::PixelBounds blockBounds{ m_pCompressedDepth->GetBlockBounds(blockX, blockY) };
+							const CompressedDepth::Block& stored{ m_pCompressedDepth->GetBlock(blockX, blockY) };
+							if (stored.state == CompressedDepth::RAW)
+							{
+								Rasterizer::PixelBounds part{};
+								part.min = { std::max(block.min.x, blockBounds.min.x), std::max(block.min.y, blockBounds.min.y) };
+								part.max = { std::min(block.max.x, blockBounds.max.x), std::min(block.max.y, blockBounds.max.y) };
+								counts += rasterizeBlock(part, isFullyCovered);
+							}
+							else if (stored.IsPlaneOf(triangleIndex))
+							{
+								counts.coveredPixels += (blockBounds.max.x - blockBounds.min.x) * (blockBounds.max.y - blockBounds.min.y);
+								ShadeDepthPlane<DepthTraits>(triangleIndex, triangle, blockBounds, stored, counts);
+							}
+						}
+					}
+					return counts;
+				};
+
+				return m_UseHierarchicalRaster ? Rasterizer::WalkBlocks(triangle, bounds, isOccluded, rasterizeCompressed) : rasterizeCompressed(bounds, false);
+			}
+		}
+
+		return m_UseHierarchicalRaster ? Rasterizer::WalkBlocks(triangle, bounds, isOccluded, rasterizeBlock) : rasterizeBlock(bounds, false);
+	}
+
+	template<typename DepthTraits, Rasterizer::Pass pass>
+	Rasterizer::RasterCounts Renderer::RasterizeScalar(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+		const Rasterizer::EdgeFunction& edge0{ triangle.edges[0] };
+		const Rasterizer::EdgeFunction& edge1{ triangle.edges[1] };
+		const Rasterizer::EdgeFunction& edge2{ triangle.edges[2] };
+
+		const Rasterizer::PlaneEquation& depthPlane{ triangle.depth };
+		const TriangleAttributes& attributes{ m_TriangleAttributes[triangleIndex] };
+		const bool isUsingVisibilityBuffer{ IsUsingVisibilityBuffer() };
+		const uint32_t clearKey{ DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE) };
+
+		//Every block gets rasterized with the same setup, blocks fully inside of the triangle skip the coverage test
+		auto rasterize = [&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+		{
+			//A block the triangle covers completely might only need its depth plane, everything else needs the pixels.
+			//The equal test never gets here with a compressed block.
+			if (pass != Rasterizer::EQUAL_DEPTH_PASS && IsDepthCompressed())
+			{
+				Rasterizer::RasterCounts planeCounts{};
+				if (isFullyCovered && DrawDepthPlane<DepthTraits, pass>(triangleIndex, triangle, block, planeCounts))
+					return planeCounts;
+
+				m_pCompressedDepth->Decompress<DepthTraits>(block, pDepthBuffer);
+			}
+
+			//Evaluate the edge functions once at the first pixel center, every other pixel is just a step away
+			const int startX{ Rasterizer::PixelCenter(block.min.x) };
+			const int startY{ Rasterizer::PixelCenter(block.min.y) };
+			int64_t rowWeight0{ edge0.Evaluate(startX, startY) + edge0.bias };
+			int64_t rowWeight1{ edge1.Evaluate(startX, startY) + edge1.bias };
+			int64_t rowWeight2{ edge2.Evaluate(startX, startY) + edge2.bias };
+
+			Rasterizer::RasterCounts counts{};
+			bool hasWrittenDepth{};
+			for (int py{ block.min.y }; py < block.max.y; ++py)
+			{
+				int64_t edgeWeight0{ rowWeight0 };
+				int64_t edgeWeight1{ rowWeight1 };
+				int64_t edgeWeight2{ rowWeight2 };
+
+				rowWeight0 += edge0.StepY();
+				rowWeight1 += edge1.StepY();
+				rowWeight2 += edge2.StepY();
+
+				//Every row starts from the plane again, so the rounding errors of the steps never pile up over the rows.
+				//The row starts at the triangle, not the block, so a pixel gets the same depth however the triangle got walked.
+				const float rowDepth{ depthPlane.Evaluate(0, py - triangle.bounds.min.y) };
+
+				for (int px{ block.min.x }; px < block.max.x; ++px,
+					edgeWeight0 += edge0.StepX(), edgeWeight1 += edge1.StepX(), edgeWeight2 += edge2.StepX())
+				{
+					//The bias makes pixels on a non top-left edge negative, so one sign test covers the fill rule
+					if (!isFullyCovered && (edgeWeight0 | edgeWeight1 | edgeWeight2) < 0)
+						continue;
+
+					++counts.coveredPixels;
+
+					const float interpolatedDepth{ rowDepth + depthPlane.stepX * (px - triangle.bounds.min.x) };
+					if (interpolatedDepth < 0.f || interpolatedDepth > 1.f)
+						continue;
+
+					//The resolve takes the clear value for a pixel nothing got drawn in, a fragment that far would get shaded for nothing
+					const uint32_t depthKey{ DepthTraits::ToKey(interpolatedDepth) };
+					if (depthKey == clearKey)
+						continue;
+
+					const int pixelIdx{ m_TiledLayout.GetPixelIndex(px, py) };
+					const uint32_t storedKey{ DepthTraits::FromStorage(pDepthBuffer[pixelIdx]) };
+					if constexpr (pass == Rasterizer::EQUAL_DEPTH_PASS)
+					{
+						//The depth pass computed the exact same key, any other key belongs to the triangle in front
+						if (storedKey != depthKey)
+							continue;
+					}
+					else
+					{
+						if (storedKey < depthKey)
+							continue;
+
+						pDepthBuffer[pixelIdx] = DepthTraits::ToStorage(depthKey);
+						hasWrittenDepth = true;
+						if constexpr (pass == Rasterizer::DEPTH_PASS)
+							continue;
+					}
+
+					if (isUsingVisibilityBuffer)
+					{
+						m_pVisibilityBuffer[pixelIdx] = triangleIndex;
+						continue;
+					}
+
+					++counts.shadedPixels;
+					ShadeFragment(triangle, attributes, px, py, DepthTraits::ToDepth(depthKey));
+				}
+			}
+
+			if (hasWrittenDepth)
+				m_pHiZBuffer->MarkDirty(block);
+
+			return counts;
+		};
+
+		return WalkTriangle<DepthTraits, pass>(triangleIndex, triangle, bounds, rasterize);
+	}
+
+	template<typename DepthTraits, Rasterizer::Pass pass>
+	Rasterizer::RasterCounts Renderer::RasterizeSSE2(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		constexpr int blockWidth{ 4 };
+		typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+
+		const Rasterizer::EdgeFunction& edge0{ triangle.edges[0] };
+		const Rasterizer::EdgeFunction& edge1{ triangle.edges[1] };
+		const Rasterizer::EdgeFunction& edge2{ triangle.edges[2] };
+
+		Rasterizer::LaneCoverage4 laneCoverage{};
+		laneCoverage.Setup(triangle);
+
+		//Every lane steps the depth plane from the start of the row on its own, exactly like the scalar kernel does,
+		//so a pixel gets the same depth in every kernel and wherever its group of lanes starts
+		const Rasterizer::PlaneEquation& depthPlane{ triangle.depth };
+		const __m128 depthStepX{ _mm_set1_ps(depthPlane.stepX) };
+		const __m128 laneOffsets{ _mm_setr_ps(0.f, 1.f, 2.f, 3.f) };
+		const TriangleAttributes& attributes{ m_TriangleAttributes[triangleIndex] };
+		const bool isUsingVisibilityBuffer{ IsUsingVisibilityBuffer() };
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.f) };
+		const __m128i clearKey{ _mm_set1_epi32(static_cast<int>(DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE))) };
+
+		//Every block gets rasterized with the same setup, blocks fully inside of the triangle skip the coverage test
+		auto rasterize = [&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+		{
+			//A block the triangle covers completely might only need its depth plane, everything else needs the pixels.
+			//The equal test never gets here with a compressed block.
+			if (pass != Rasterizer::EQUAL_DEPTH_PASS && IsDepthCompressed())
+			{
+				Rasterizer::RasterCounts planeCounts{};
+				if (isFullyCovered && DrawDepthPlane<DepthTraits, pass>(triangleIndex, triangle, block, planeCounts))
+					return planeCounts;
+
+				m_pCompressedDepth->Decompress<DepthTraits>(block, pDepthBuffer);
+			}
+
+			const int startX{ Rasterizer::PixelCenter(block.min.x) };
+			const int startY{ Rasterizer::PixelCenter(block.min.y) };
+			int64_t rowWeight0{ edge0.Evaluate(startX, startY) + edge0.bias };
+			int64_t rowWeight1{ edge1.Evaluate(startX, startY) + edge1.bias };
+			int64_t rowWeight2{ edge2.Evaluate(startX, startY) + edge2.bias };
+
+			alignas(16) uint32_t depthKeys[blockWidth];
+			alignas(16) typename DepthTraits::Storage partialBlock[blockWidth]{};
+
+			Rasterizer::RasterCounts counts{};
+			bool hasWrittenDepth{};
+			for (int py{ block.min.y }; py < block.max.y; ++py)
+			{
+				int64_t edgeWeight0{ rowWeight0 };
+				int64_t edgeWeight1{ rowWeight1 };
+				int64_t edgeWeight2{ rowWeight2 };
+
+				rowWeight0 += edge0.StepY();
+				rowWeight1 += edge1.StepY();
+				rowWeight2 += edge2.StepY();
+
+				const float rowDepth{ depthPlane.Evaluate(0, py - triangle.bounds.min.y) };
+
+				for (int px{ block.min.x }; px < block.max.x; px += blockWidth,
+					edgeWeight0 += blockWidth * edge0.StepX(), edgeWeight1 += blockWidth * edge1.StepX(), edgeWeight2 += blockWidth * edge2.StepX())
+				{
+					//The lanes past the end of the block belong to the next block or tile
+					const int numValidLanes{ std::min(block.max.x - px, blockWidth) };
+					const int validMask{ (1 << numValidLanes) - 1 };
+					const int coverageMask{ isFullyCovered ? validMask : laneCoverage.GetMask(edgeWeight0, edgeWeight1, edgeWeight2) & validMask };
+					if (coverageMask == 0)
+						continue;
+
+					counts.coveredPixels += std::popcount(static_cast<uint32_t>(coverageMask));
+
+					const __m128 laneX{ _mm_add_ps(_mm_set1_ps(static_cast<float>(px - triangle.bounds.min.x)), laneOffsets) };
+					const __m128 interpolatedDepth{ _mm_add_ps(_mm_set1_ps(rowDepth), _mm_mul_ps(depthStepX, laneX)) };
+					const __m128i depthKey{ DepthTraits::ToKeys(interpolatedDepth) };
+
+					//A partial block can't touch the pixels next to it, they belong to another tile
+					const int pixelIdx{ m_TiledLayout.GetPixelIndex(px, py) };
+					typename DepthTraits::Storage* const pStored{ pDepthBuffer + pixelIdx };
+					const bool isFullBlock{ numValidLanes == blockWidth };
+					if (!isFullBlock)
+						std::copy_n(pStored, numValidLanes, partialBlock);
+
+					//Keys outside of [0, 1] are garbage, the range test throws those lanes out, and the lanes as far as the clear value with them
+					const __m128i storedKey{ DepthTraits::LoadKeys4(isFullBlock ? pStored : partialBlock) };
+					const __m128 isInRange{ _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(depthKey, clearKey)),
+						_mm_and_ps(_mm_cmpge_ps(interpolatedDepth, zero), _mm_cmple_ps(interpolatedDepth, one))) };
+					const __m128 depthPass{ pass == Rasterizer::EQUAL_DEPTH_PASS
+						? _mm_and_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(depthKey, storedKey)), isInRange)
+						: _mm_andnot_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(depthKey, storedKey)), isInRange) };
+
+					const int writeMask{ coverageMask & _mm_movemask_ps(depthPass) };
+					if (writeMask == 0)
+						continue;
+
+					if constexpr (pass != Rasterizer::EQUAL_DEPTH_PASS)
+					{
+						hasWrittenDepth = true;
+
+						const __m128i writeLanes{ _mm_cmpeq_epi32(
+							_mm_and_si128(_mm_set1_epi32(writeMask), _mm_setr_epi32(1, 2, 4, 8)), _mm_setr_epi32(1, 2, 4, 8)) };
+						const __m128i newKey{ _mm_or_si128(_mm_and_si128(writeLanes, depthKey), _mm_andnot_si128(writeLanes, storedKey)) };
+
+						if (isFullBlock)
+							DepthTraits::StoreKeys4(pStored, newKey);
+						else
+						{
+							DepthTraits::StoreKeys4(partialBlock, newKey);
+							std::copy_n(partialBlock, numValidLanes, pStored);
+						}
+
+						if constexpr (pass == Rasterizer::DEPTH_PASS)
+							continue;
+					}
+
+					if (isUsingVisibilityBuffer)
+					{
+						for (int mask{ writeMask }; mask != 0; mask &= mask - 1)
+							m_pVisibilityBuffer[pixelIdx + std::countr_zero(static_cast<uint32_t>(mask))] = triangleIndex;
+						continue;
+					}
+
+					counts.shadedPixels += std::popcount(static_cast<uint32_t>(writeMask));
+
+					_mm_store_si128(reinterpret_cast<__m128i*>(depthKeys), depthKey);
+					for (int mask{ writeMask }; mask != 0; mask &= mask - 1)
+					{
+						const int lane{ std::countr_zero(static_cast<uint32_t>(mask)) };
+						ShadeFragment(triangle, attributes, px + lane, py, DepthTraits::ToDepth(depthKeys[lane]));
+					}
+				}
+			}
+
+			if (hasWrittenDepth)
+				m_pHiZBuffer->MarkDirty(block);
+
+			return counts;
+		};
+
+		return WalkTriangle<DepthTraits, pass>(triangleIndex, triangle, bounds, rasterize);
+	}
+
+	template<typename DepthTraits, Rasterizer::Pass pass>
+	Rasterizer::RasterCounts Renderer::RasterizeAVX2(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		constexpr int blockWidth{ 8 };
+		typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+
+		const Rasterizer::EdgeFunction& edge0{ triangle.edges[0] };
+		const Rasterizer::EdgeFunction& edge1{ triangle.edges[1] };
+		const Rasterizer::EdgeFunction& edge2{ triangle.edges[2] };
+
+		Rasterizer::LaneCoverage8 laneCoverage{};
+		laneCoverage.Setup(triangle);
+
+		//Every lane steps the depth plane from the start of the row on its own, the same as in the other kernels
+		const Rasterizer::PlaneEquation& depthPlane{ triangle.depth };
+		const __m256 depthStepX{ _mm256_set1_ps(depthPlane.stepX) };
+		const __m256 laneOffsets{ _mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f) };
+		const TriangleAttributes& attributes{ m_TriangleAttributes[triangleIndex] };
+		const bool isUsingVisibilityBuffer{ IsUsingVisibilityBuffer() };
+		const __m256 zero{ _mm256_setzero_ps() };
+		const __m256 one{ _mm256_set1_ps(1.f) };
+		const __m256i clearKey{ _mm256_set1_epi32(static_cast<int>(DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE))) };
+
+		const __m256i laneBits{ _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128) };
+
+		//Every block gets rasterized with the same setup, blocks fully inside of the triangle skip the coverage test
+		auto rasterize = [&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+		{
+			//A block the triangle covers completely might only need its depth plane, everything else needs the pixels.
+			//The equal test never gets here with a compressed block.
+			if (pass != Rasterizer::EQUAL_DEPTH_PASS && IsDepthCompressed())
+			{
+				Rasterizer::RasterCounts planeCounts{};
+				if (isFullyCovered && DrawDepthPlane<DepthTraits, pass>(triangleIndex, triangle, block, planeCounts))
+					return planeCounts;
+
+				m_pCompressedDepth->Decompress<DepthTraits>(block, pDepthBuffer);
+			}
+
+			const int startX{ Rasterizer::PixelCenter(block.min.x) };
+			const int startY{ Rasterizer::PixelCenter(block.min.y) };
+			int64_t rowWeight0{ edge0.Evaluate(startX, startY) + edge0.bias };
+			int64_t rowWeight1{ edge1.Evaluate(startX, startY) + edge1.bias };
+			int64_t rowWeight2{ edge2.Evaluate(startX, startY) + edge2.bias };
+
+			alignas(32) uint32_t depthKeys[blockWidth];
+			alignas(32) typename DepthTraits::Storage partialBlock[blockWidth]{};
+			FragmentBatch batch{};
+
+			Rasterizer::RasterCounts counts{};
+			bool hasWrittenDepth{};
+			for (int py{ block.min.y }; py < block.max.y; ++py)
+			{
+				int64_t edgeWeight0{ rowWeight0 };
+				int64_t edgeWeight1{ rowWeight1 };
+				int64_t edgeWeight2{ rowWeight2 };
+
+				rowWeight0 += edge0.StepY();
+				rowWeight1 += edge1.StepY();
+				rowWeight2 += edge2.StepY();
+
+				const float rowDepth{ depthPlane.Evaluate(0, py - triangle.bounds.min.y) };
+
+				for (int px{ block.min.x }; px < block.max.x; px += blockWidth,
+					edgeWeight0 += blockWidth * edge0.StepX(), edgeWeight1 += blockWidth * edge1.StepX(), edgeWeight2 += blockWidth * edge2.StepX())
+				{
+					const int numValidLanes{ std::min(block.max.x - px, blockWidth) };
+					const int validMask{ (1 << numValidLanes) - 1 };
+					const int coverageMask{ isFullyCovered ? validMask : laneCoverage.GetMask(edgeWeight0, edgeWeight1, edgeWeight2) & validMask };
+					if (coverageMask == 0)
+						continue;
+
+					counts.coveredPixels += std::popcount(static_cast<uint32_t>(coverageMask));
+
+					const __m256 laneX{ _mm256_add_ps(_mm256_set1_ps(static_cast<float>(px - triangle.bounds.min.x)), laneOffsets) };
+					const __m256 interpolatedDepth{ _mm256_add_ps(_mm256_set1_ps(rowDepth), _mm256_mul_ps(depthStepX, laneX)) };
+
+					const __m256i depthKey{ DepthTraits::ToKeys(interpolatedDepth) };
+
+					//A partial block can't touch the pixels next to it, they belong to another tile
+					const int pixelIdx{ m_TiledLayout.GetPixelIndex(px, py) };
+					typename DepthTraits::Storage* const pStored{ pDepthBuffer + pixelIdx };
+					const bool isFullBlock{ numValidLanes == blockWidth };
+					if (!isFullBlock)
+						std::copy_n(pStored, numValidLanes, partialBlock);
+
+					//Keys outside of [0, 1] are garbage, the range test throws those lanes out, and the lanes as far as the clear value with them
+					const __m256i storedKey{ DepthTraits::LoadKeys8(isFullBlock ? pStored : partialBlock) };
+					const __m256 isInRange{ _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(depthKey, clearKey)),
+						_mm256_and_ps(_mm256_cmp_ps(interpolatedDepth, zero, _CMP_GE_OQ), _mm256_cmp_ps(interpolatedDepth, one, _CMP_LE_OQ))) };
+					const __m256 depthPass{ pass == Rasterizer::EQUAL_DEPTH_PASS
+						? _mm256_and_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(depthKey, storedKey)), isInRange)
+						: _mm256_andnot_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(depthKey, storedKey)), isInRange) };
+
+					const int writeMask{ coverageMask & _mm256_movemask_ps(depthPass) };
+					if (writeMask == 0)
+						continue;
+
+					const __m256i writeLanes{ _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(writeMask), laneBits), laneBits) };
+					if constexpr (pass != Rasterizer::EQUAL_DEPTH_PASS)
+					{
+						hasWrittenDepth = true;
+
+						const __m256i newKey{ _mm256_blendv_epi8(storedKey, depthKey, writeLanes) };
+						if (isFullBlock)
+							DepthTraits::StoreKeys8(pStored, newKey);
+						else
+						{
+							DepthTraits::StoreKeys8(partialBlock, newKey);
+							std::copy_n(partialBlock, numValidLanes, pStored);
+						}
+
+						if constexpr (pass == Rasterizer::DEPTH_PASS)
+							continue;
+					}
+
+					if (isUsingVisibilityBuffer)
+					{
+						_mm256_maskstore_epi32(reinterpret_cast<int*>(m_pVisibilityBuffer + pixelIdx), writeLanes, _mm256_set1_epi32(static_cast<int>(triangleIndex)));
+						continue;
+					}
+
+					counts.shadedPixels += std::popcount(static_cast<uint32_t>(writeMask));
+
+					_mm256_store_si256(reinterpret_cast<__m256i*>(depthKeys), depthKey);
+
+					for (int mask{ writeMask }; mask != 0; mask &= mask - 1)
+					{
+						const int lane{ std::countr_zero(static_cast<uint32_t>(mask)) };
+						AddFragment(batch, triangleIndex, px + lane, py, DepthTraits::ToDepth(depthKeys[lane]));
+					}
+				}
+			}
+			FlushFragments(batch);
+
+			if (hasWrittenDepth)
+				m_pHiZBuffer->MarkDirty(block);
+
+			return counts;
+		};
+
+		return WalkTriangle<DepthTraits, pass>(triangleIndex, triangle, bounds, rasterize);
+	}
+
+	template<typename DepthTraits, int sampleCount>
+	Rasterizer::RasterCounts Renderer::RasterizeMultisampled(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const
+	{
+		constexpr int allSamples{ (1 << sampleCount) - 1 };
+		const int samplePlane{ m_TiledLayout.GetNumPixels() };
+		typename DepthTraits::Storage* const pDepthBuffer{ GetDepthBuffer<DepthTraits>() };
+		const uint32_t clearKey{ DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE) };
+		const Rasterizer::EdgeFunction& edge0{ triangle.edges[0] };
+		const Rasterizer::EdgeFunction& edge1{ triangle.edges[1] };
+		const Rasterizer::EdgeFunction& edge2{ triangle.edges[2] };
+
+		const Rasterizer::PlaneEquation& depthPlane{ triangle.depth };
+		const TriangleAttributes& attributes{ m_TriangleAttributes[triangleIndex] };
+
+		//The edge functions and the depth of a sample are a constant offset away from those of the pixel center
+		const Int2* const pSampleOffsets{ Rasterizer::GetSampleOffsets(sampleCount) };
+		int64_t sampleEdgeOffsets[3][sampleCount]{};
+		float sampleDepthOffsets[sampleCount]{};
+		for (int sample{ 0 }; sample < sampleCount; ++sample)
+		{
+			const int offsetX{ pSampleOffsets[sample].x * Rasterizer::SUBPIXEL_ONE / 16 };
+			const int offsetY{ pSampleOffsets[sample].y * Rasterizer::SUBPIXEL_ONE / 16 };
+			for (int edge{ 0 }; edge < 3; ++edge)
+				sampleEdgeOffsets[edge][sample] = triangle.edges[edge].a * offsetX + triangle.edges[edge].b * offsetY;
+			sampleDepthOffsets[sample] = (depthPlane.stepX * pSampleOffsets[sample].x + depthPlane.stepY * pSampleOffsets[sample].y) / 16.f;
+		}
+
+		//Every block gets rasterized with the same setup, blocks fully inside of the triangle skip the coverage test
+		auto rasterize = [&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+		{
+			const int startX{ Rasterizer::PixelCenter(block.min.x) };
+			const int startY{ Rasterizer::PixelCenter(block.min.y) };
+			int64_t rowWeight0{ edge0.Evaluate(startX, startY) + edge0.bias };
+			int64_t rowWeight1{ edge1.Evaluate(startX, startY) + edge1.bias };
+			int64_t rowWeight2{ edge2.Evaluate(startX, startY) + edge2.bias };
+
+			Rasterizer::RasterCounts counts{};
+			bool hasWrittenDepth{};
+			for (int py{ block.min.y }; py < block.max.y; ++py)
+			{
+				int64_t edgeWeight0{ rowWeight0 };
+				int64_t edgeWeight1{ rowWeight1 };
+				int64_t edgeWeight2{ rowWeight2 };
+
+				rowWeight0 += edge0.StepY();
+				rowWeight1 += edge1.StepY();
+				rowWeight2 += edge2.StepY();
+
+				const float rowDepth{ depthPlane.Evaluate(0, py - triangle.bounds.min.y) };
+
+				for (int px{ block.min.x }; px < block.max.x; ++px,
+					edgeWeight0 += edge0.StepX(), edgeWeight1 += edge1.StepX(), edgeWeight2 += edge2.StepX())
+				{
+					int coverageMask{ allSamples };
+					if (!isFullyCovered)
+					{
+						coverageMask = 0;
+						for (int sample{ 0 }; sample < sampleCount; ++sample)
+						{
+							const int64_t outside{ (edgeWeight0 + sampleEdgeOffsets[0][sample]) | (edgeWeight1 + sampleEdgeOffsets[1][sample])
+								| (edgeWeight2 + sampleEdgeOffsets[2][sample]) };
+							coverageMask |= (outside >= 0) << sample;
+						}
+						if (coverageMask == 0)
+							continue;
+					}
+
+					++counts.coveredPixels;
+
+					//Depth gets tested and stored per sample
+					const float centerDepth{ rowDepth + depthPlane.stepX * (px - triangle.bounds.min.x) };
+					const int pixelIdx{ m_TiledLayout.GetPixelIndex(px, py) };
+					int writeMask{};
+					for (int mask{ coverageMask }; mask != 0; mask &= mask - 1)
+					{
+						const int sample{ std::countr_zero(static_cast<uint32_t>(mask)) };
+						const float sampleDepth{ centerDepth + sampleDepthOffsets[sample] };
+						if (sampleDepth < 0.f || sampleDepth > 1.f)
+							continue;
+
+						//A sample as far as the clear value would resolve to the clear color anyway
+						const uint32_t depthKey{ DepthTraits::ToKey(sampleDepth) };
+						typename DepthTraits::Storage& stored{ pDepthBuffer[sample * samplePlane + pixelIdx] };
+						if (DepthTraits::FromStorage(stored) < depthKey || depthKey == clearKey)
+							continue;
+
+						stored = DepthTraits::ToStorage(depthKey);
+						writeMask |= 1 << sample;
+					}
+
+					if (writeMask == 0)
+						continue;
+
+					hasWrittenDepth = true;
+
+					//Shaded once at the pixel center, whichever of its samples the triangle covers
+					++counts.shadedPixels;
+					const uint32_t color{ GetFragmentColor(triangle, attributes, px, py, DepthTraits::ToDepth(DepthTraits::ToKey(std::clamp(centerDepth, 0.f, 1.f)))) };
+
+					//A block where every write covered all samples keeps a single color per pixel, in the first sample
+					uint8_t& isUniform{ m_pIsSampleUniform[(px / Rasterizer::BLOCK_SIZE) + (py / Rasterizer::BLOCK_SIZE) * m_NumBlocksX] };
+					if (isUniform && writeMask != allSamples)
+					{
+						ExpandSamples(px / Rasterizer::BLOCK_SIZE, py / Rasterizer::BLOCK_SIZE);
+						isUniform = false;
+					}
+
+					if (isUniform)
+						m_pColorBuffer[pixelIdx] = color;
+					else
+					{
+						for (int mask{ writeMask }; mask != 0; mask &= mask - 1)
+							m_pColorBuffer[std::countr_zero(static_cast<uint32_t>(mask)) * samplePlane + pixelIdx] = color;
+					}
+				}
+			}
+
+			if (hasWrittenDepth)
+				m_pHiZBuffer->MarkDirty(block);
+
+			return counts;
+		};
+
+		return WalkTriangle<DepthTraits, Rasterizer::COLOR_PASS>(triangleIndex, triangle, bounds, rasterize);
+	}
+
+	void Renderer::ExpandSamples(int blockX, int blockY) const
+	{
+		const Rasterizer::PixelBounds blockBounds{ m_pCompressedDepth->GetBlockBounds(blockX, blockY) };
+		for (int sample{ 1 }; sample < m_SampleCount; ++sample)
+		{
+			for (int py{ blockBounds.min.y }; py < blockBounds.max.y; ++py)
+			{
+				uint32_t* const pRow{ m_pColorBuffer + m_TiledLayout.GetPixelIndex(blockBounds.min.x, py) };
+				std::copy_n(pRow, blockBounds.max.x - blockBounds.min.x, pRow + sample * m_TiledLayout.GetNumPixels());
+			}
+		}
+	}
+
+	void Renderer::ShadeFragment(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const
+	{
+		m_pColorBuffer[m_TiledLayout.GetPixelIndex(px, py)] = GetFragmentColor(triangle, attributes, px, py, interpolatedDepth);
+	}
+
+	void Renderer::AddFragment(FragmentBatch& batch, uint32_t triangleIndex, int px, int py, float depth) const
+	{
+		const int fragment{ batch.numFragments++ };
+		batch.triangleIndices[fragment] = triangleIndex;
+		batch.px[fragment] = px;
+		batch.py[fragment] = py;
+		batch.depths[fragment] = depth;
+
+		if (batch.numFragments == FragmentBatch::SIZE)
+			FlushFragments(batch);
+	}
+
+	void Renderer::FlushFragments(FragmentBatch& batch) const
+	{
+		if (batch.numFragments == 0)
+			return;
+
+		(this->*m_BatchShader)(batch);
+		batch.numFragments = 0;
+	}
+
+	void Renderer::ShadeBatchScalar(const FragmentBatch& batch) const
+	{
+		for (int fragment{ 0 }; fragment < batch.numFragments; ++fragment)
+		{
+			const uint32_t triangleIndex{ batch.triangleIndices[fragment] };
+			ShadeFragment(m_Triangles[triangleIndex], m_TriangleAttributes[triangleIndex], batch.px[fragment], batch.py[fragment], batch.depths[fragment]);
+		}
+	}
+
+	Renderer::BatchShader Renderer::SelectBatchShader() const
+	{
+		//The wide kernel is part of the AVX2 path, and only has the combined shading mode
+		if (!m_UseWideShading || m_RasterKernel != Rasterizer::AVX2 || m_CurrentRenderMode != TEXTURE || m_CurrentShadingMode != COMBINED)
+			return &Renderer::ShadeBatchScalar;
+
+		if (m_UseFastMath)
+			return m_UseNormalMap ? &Renderer::ShadeBatchWide<true, true> : &Renderer::ShadeBatchWide<false, true>;
+		return m_UseNormalMap ? &Renderer::ShadeBatchWide<true, false> : &Renderer::ShadeBatchWide<false, false>;
+	}
+
+	//Matches ShadePixel<TEXTURE, COMBINED, useNormalMap> to within 1/255 per channel. The difference is in powf against SimdMath::Pow
+	//and in the order the compiler is free to pick for the scalar math, the texel fetches and everything else are the same operations.
+	//Fast math trades that for fewer divides and no log/exp, ReportFastMathError measures what it costs.
+	template<bool useNormalMap, bool useFastMath>
+	void Renderer::ShadeBatchWide(const FragmentBatch& batch) const
+	{
+		constexpr int numLanes{ FragmentBatch::SIZE };
+
+		//Interpolation stays per fragment, every lane can have a triangle of its own. Lanes past the last fragment repeat the first.
+		alignas(32) float u[numLanes];
+		alignas(32) float v[numLanes];
+		alignas(32) float normals[3][numLanes];
+		alignas(32) float tangents[3][numLanes];
+		alignas(32) float viewDirections[3][numLanes];
+		for (int lane{ 0 }; lane < numLanes; ++lane)
+		{
+			const int fragment{ lane < batch.numFragments ? lane : 0 };
+			const Rasterizer::Triangle& triangle{ m_Triangles[batch.triangleIndices[fragment]] };
+			const TriangleAttributes& attributes{ m_TriangleAttributes[batch.triangleIndices[fragment]] };
+			const int offsetX{ batch.px[fragment] - triangle.bounds.min.x };
+			const int offsetY{ batch.py[fragment] - triangle.bounds.min.y };
+
+			const float wInterpolated{ 1.f / attributes.invW.Evaluate(offsetX, offsetY) };
+			u[lane] = std::max(attributes.uv[0].Evaluate(offsetX, offsetY) * wInterpolated, 0.f);
+			v[lane] = std::max(attributes.uv[1].Evaluate(offsetX, offsetY) * wInterpolated, 0.f);
+
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				normals[axis][lane] = attributes.normal[axis].Evaluate(offsetX, offsetY);
+				viewDirections[axis][lane] = attributes.viewDirection[axis].Evaluate(offsetX, offsetY);
+				if constexpr (useNormalMap)
+					tangents[axis][lane] = attributes.tangent[axis].Evaluate(offsetX, offsetY);
+			}
+		}
+
+		using Vector = std::array<__m256, 3>;
+		auto load = [](const float (&stream)[3][numLanes])
+		{
+			return Vector{ _mm256_load_ps(stream[0]), _mm256_load_ps(stream[1]), _mm256_load_ps(stream[2]) };
+		};
+		auto dot = [](const Vector& a, const Vector& b)
+		{
+			return _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a[0], b[0]), _mm256_mul_ps(a[1], b[1])), _mm256_mul_ps(a[2], b[2]));
+		};
+		auto normalize = [&](Vector& vector)
+		{
+			if constexpr (useFastMath)
+			{
+				//rsqrt is good for 12 bits, one Newton-Raphson step brings that to about 22
+				const __m256 squaredMagnitude{ dot(vector, vector) };
+				const __m256 estimate{ _mm256_rsqrt_ps(squaredMagnitude) };
+				const __m256 halfSquaredEstimate{ _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(.5f), squaredMagnitude), _mm256_mul_ps(estimate, estimate)) };
+				const __m256 inverseMagnitude{ _mm256_mul_ps(estimate, _mm256_sub_ps(_mm256_set1_ps(1.5f), halfSquaredEstimate)) };
+				for (__m256& component : vector)
+					component = _mm256_mul_ps(component, inverseMagnitude);
+			}
+			else
+			{
+				const __m256 magnitude{ _mm256_sqrt_ps(dot(vector, vector)) };
+				for (__m256& component : vector)
+					component = _mm256_div_ps(component, magnitude);
+			}
+		};
+
+		const __m256 uvX{ _mm256_load_ps(u) };
+		const __m256 uvY{ _mm256_load_ps(v) };
+		Vector normal{ load(normals) };
+		normalize(normal);
+		Vector viewDirection{ load(viewDirections) };
+		normalize(viewDirection);
+
+		if constexpr (useNormalMap)
+		{
+			Vector tangent{ load(tangents) };
+			normalize(tangent);
+			const Vector binormal{
+				_mm256_sub_ps(_mm256_mul_ps(normal[1], tangent[2]), _mm256_mul_ps(normal[2], tangent[1])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[2], tangent[0]), _mm256_mul_ps(normal[0], tangent[2])),
+				_mm256_sub_ps(_mm256_mul_ps(normal[0], tangent[1]), _mm256_mul_ps(normal[1], tangent[0])) };
+
+			Vector normalMap{};
+			m_pNormalMap->Sample8(uvX, uvY, normalMap[0], normalMap[1], normalMap[2]);
+			for (__m256& component : normalMap)
+				component = _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(2.f), component), _mm256_set1_ps(1.f));
+
+			//The tangent space matrix has the tangent, binormal and normal as its rows
+			Vector mappedNormal{};
+			for (int axis{ 0 }; axis < 3; ++axis)
+			{
+				mappedNormal[axis] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tangent[axis], normalMap[0]),
+					_mm256_mul_ps(binormal[axis], normalMap[1])), _mm256_mul_ps(normal[axis], normalMap[2]));
+			}
+			normal = mappedNormal;
+		}
+
+		//Same parameters as PixelShading
+		const Vector toLight{ _mm256_set1_ps(-.577f), _mm256_set1_ps(.577f), _mm256_set1_ps(-.577f) };
+		constexpr float kd{ 1.f };
+		constexpr float lightIntensity{ 7.f };
+		constexpr float shininess{ SHININESS };
+
+		const __m256 observedArea{ _mm256_max_ps(dot(normal, toLight), _mm256_setzero_ps()) };
+
+		Vector lambert{};
+		m_pTexture->Sample8(uvX, uvY, lambert[0], lambert[1], lambert[2]);
+		for (__m256& channel : lambert)
+			channel = _mm256_div_ps(_mm256_mul_ps(channel, _mm256_set1_ps(kd)), _mm256_set1_ps(PI));
+
+		__m256 glossiness{}, specular{}, unused{};
+		m_pGlossinessMap->Sample8(uvX, uvY, glossiness, unused, unused);
+		m_pSpecularMap->Sample8(uvX, uvY, specular, unused, unused);
 
-		//Software
-		delete m_pTexture;
-		delete m_pNormalMap;
-		delete m_pGlossinessMap;
-		delete m_pSpecularMap;
-		delete[] m_pDepthBufferPixels;
+		//Vector3::Reflect(-lightDirection, normal)
+		const __m256 twiceDot{ _mm256_mul_ps(_mm256_set1_ps(2.f), dot(toLight, normal)) };
+		Vector reflect{};
+		for (int axis{ 0 }; axis < 3; ++axis)
+			reflect[axis] = _mm256_sub_ps(toLight[axis], _mm256_mul_ps(twiceDot, normal[axis]));
 
+		const __m256 alfa{ dot(reflect, viewDirection) };
+		const __m256 isFacing{ _mm256_cmp_ps(alfa, _mm256_setzero_ps(), _CMP_GE_OQ) };
+		__m256 specularPower{};
+		if constexpr (useFastMath)
+		{
+			//The table has a row per texel value of the glossiness map
+			const __m256i glossinessTexel{ _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(glossiness, _mm256_set1_ps(255.f)), _mm256_set1_ps(.5f))) };
+			specularPower = m_SpecularTable.Lookup8(alfa, glossinessTexel);
+
+			//The normal map can make alfa larger than 1, where the power blows up instead of staying in the table
+			const __m256 isAboveTable{ _mm256_cmp_ps(alfa, _mm256_set1_ps(1.f), _CMP_GT_OQ) };
+			if (_mm256_movemask_ps(isAboveTable) != 0)
+				specularPower = _mm256_blendv_ps(specularPower, SimdMath::Pow(alfa, _mm256_mul_ps(glossiness, _mm256_set1_ps(shininess))), isAboveTable);
+		}
+		else specularPower = SimdMath::Pow(alfa, _mm256_mul_ps(glossiness, _mm256_set1_ps(shininess)));
+		const __m256 phong{ _mm256_and_ps(isFacing, _mm256_mul_ps(specular, specularPower)) };
 
-	}
+		Vector color{};
+		for (int channel{ 0 }; channel < 3; ++channel)
+			color[channel] = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(lambert[channel], _mm256_set1_ps(lightIntensity)), observedArea), phong);
 
-	void Renderer::Update(const Timer* pTimer)
-	{
-		m_pCamera->Update(pTimer);
-		m_pVehicleMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
-		m_pFireMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
-		m_pFireMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
-		if (m_DoesRotate)
+		//MaxToOne
+		const __m256 maxValue{ _mm256_max_ps(color[0], _mm256_max_ps(color[1], color[2])) };
+		const __m256 divisor{ _mm256_max_ps(maxValue, _mm256_set1_ps(1.f)) };
+
+		alignas(32) int channels[3][numLanes];
+		for (int channel{ 0 }; channel < 3; ++channel)
 		{
-			constexpr float rotationSpeed{ 45.f };
-			m_pVehicleMesh->RotateY(TO_RADIANS * rotationSpeed * pTimer->GetElapsed());
-			m_pFireMesh->RotateY(TO_RADIANS * rotationSpeed * pTimer->GetElapsed());
-			
+			const __m256 scaled{ _mm256_mul_ps(_mm256_div_ps(color[channel], divisor), _mm256_set1_ps(255.f)) };
+			_mm256_store_si256(reinterpret_cast<__m256i*>(channels[channel]), _mm256_cvttps_epi32(scaled));
 		}
 
+		for (int fragment{ 0 }; fragment < batch.numFragments; ++fragment)
+		{
+			m_pColorBuffer[m_TiledLayout.GetPixelIndex(batch.px[fragment], batch.py[fragment])] = SDL_MapRGB(m_pBackBuffer->format,
+				static_cast<uint8_t>(channels[0][fragment]), static_cast<uint8_t>(channels[1][fragment]), static_cast<uint8_t>(channels[2][fragment]));
+		}
 	}
 
-	void Renderer::InitializeDX()
+	uint32_t Renderer::GetFragmentColor(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const
 	{
-		//------------
-		//  VEHICLE
-		//------------
-		const auto pEffect = new EffectPosTex(m_pDevice, L"Effects/effect.fx"); //We don't delete this since it will be copied by the mesh ptr and deleted after
-		const auto pSpecularTexture = new Texture("Resources/vehicle_specular.png", m_pDevice, Texture::Specular);
-		const auto pGlossTexture = new Texture("Resources/vehicle_gloss.png", m_pDevice, Texture::Gloss);
-		const auto pNormalTexture = new Texture("Resources/vehicle_normal.png", m_pDevice, Texture::Normal);
-		const auto pDiffuseTexture = new Texture("Resources/vehicle_diffuse.png", m_pDevice, Texture::Diffuse);
-
-		m_pVehicleMesh = new Mesh(m_pDevice, pEffect, "Resources/vehicle.obj");
-		m_pVehicleMesh->InitializeMeshMatrices({ 0,0,50 }, { 0, PI_DIV_2,0 }, { 1,1,1 });
-		m_pVehicleMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
-		pEffect->SetTexture(pDiffuseTexture, Texture::Diffuse);
-		pEffect->SetTexture(pGlossTexture, Texture::Gloss);
-		pEffect->SetTexture(pNormalTexture, Texture::Normal);
-		pEffect->SetTexture(pSpecularTexture, Texture::Specular);
+		return (this->*m_PixelShader)(triangle, attributes, px, py, interpolatedDepth);
+	}
 
-		//------------
-		//   FLAME	  
-		//------------ 
-		const auto pTransparentEffect = new EffectTransparent(m_pDevice, L"Effects/transparency.fx");
-		const auto pFireDiffuseTexture = new Texture("Resources/fireFX_diffuse.png", m_pDevice, Texture::Diffuse);
-		pTransparentEffect->SetTexture(pFireDiffuseTexture, Texture::Diffuse);
-		m_pFireMesh = new Mesh(m_pDevice, pTransparentEffect, "Resources/fireFX.obj");
-		m_pFireMesh->InitializeMeshMatrices({ 0,0,50 }, { 0, PI_DIV_2,0 }, { 1,1,1 });
+	Renderer::PixelShader Renderer::SelectPixelShader() const
+	{
+		//Depth visualization doesn't look at the shading mode or the normal map
+		if (m_CurrentRenderMode == DEPTH_VALUES)
+			return &Renderer::ShadePixel<DEPTH_VALUES, COMBINED, false>;
 
-		//Delete the temporary textures
-		delete pFireDiffuseTexture;
-		delete pSpecularTexture;
-		delete pGlossTexture;
-		delete pNormalTexture;
-		delete pDiffuseTexture;
+		//[shading mode][normal map], diffuse and specular don't use the normals so they only have the one permutation.
+		//Bounding box mode fills the bounds without ever calling a pixel shader, it gets these as well.
+		static constexpr PixelShader texturePixelShaders[][2]
+		{
+			{ &Renderer::ShadePixel<TEXTURE, COMBINED, false>, &Renderer::ShadePixel<TEXTURE, COMBINED, true> },
+			{ &Renderer::ShadePixel<TEXTURE, OBSERVED_AREA, false>, &Renderer::ShadePixel<TEXTURE, OBSERVED_AREA, true> },
+			{ &Renderer::ShadePixel<TEXTURE, DIFFUSE, false>, &Renderer::ShadePixel<TEXTURE, DIFFUSE, false> },
+			{ &Renderer::ShadePixel<TEXTURE, SPECULAR, false>, &Renderer::ShadePixel<TEXTURE, SPECULAR, false> }
+		};
+		return texturePixelShaders[m_CurrentShadingMode][m_UseNormalMap];
 	}
 
-	void Renderer::InitializeSoftware()
+	template<Renderer::RenderingMode renderMode, Renderer::ShadingMode shadingMode, bool useNormalMap>
+	uint32_t Renderer::ShadePixel(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const
 	{
-		SDL_GetWindowSize(m_pWindow, &m_Width, &m_Height);
+		static_assert(renderMode != BOUNDING_BOX, "Bounding box mode doesn't shade pixels");
 
-		//Create Buffers
-		m_pFrontBuffer = SDL_GetWindowSurface(m_pWindow);
-		m_pBackBuffer = SDL_CreateRGBSurface(0, m_Width, m_Height, 32, 0, 0, 0, 0);
-		m_pBackBufferPixels = (uint32_t*)m_pBackBuffer->pixels;
+		ColorRGB finalColor{};
+		if constexpr (renderMode == DEPTH_VALUES)
+		{
+			//Only the depth, none of the attributes
+			auto remap = [](float value, float min, float max)
+			{
+				return (value - min) / (max - min);
+			};
 
-		m_pDepthBufferPixels = new float[m_Width * m_Height];
+			const float remappedResult = remap(ToVisualizedDepth(interpolatedDepth), 0.995f, 1.f);
+			finalColor = { remappedResult, remappedResult,remappedResult };
+		}
+		else
+		{
+			//What PixelShading reads of the vertex, the normal map needs the UVs and the tangent on top of the normal
+			constexpr bool usesNormal{ shadingMode == COMBINED || shadingMode == OBSERVED_AREA };
+			constexpr bool usesTangent{ usesNormal && useNormalMap };
+			constexpr bool usesUV{ shadingMode != OBSERVED_AREA || useNormalMap };
+			constexpr bool usesViewDirection{ shadingMode == COMBINED };
+
+			const int offsetX{ px - triangle.bounds.min.x };
+			const int offsetY{ py - triangle.bounds.min.y };
+			Vertex_Out pixelOut{};
+
+			//UVs, the only perspective correct attribute
+			if constexpr (usesUV)
+			{
+				const float wInterpolated{ 1.f / attributes.invW.Evaluate(offsetX, offsetY) };
+				Vector2 UVInterpolated{ attributes.uv[0].Evaluate(offsetX, offsetY) * wInterpolated,
+					attributes.uv[1].Evaluate(offsetX, offsetY) * wInterpolated };
+				UVInterpolated.y = std::max(UVInterpolated.y, 0.f);
+				UVInterpolated.x = std::max(UVInterpolated.x, 0.f);
+				pixelOut.uv = UVInterpolated;
+			}
 
-		//Initialize all values to FLT_MAX
-		for (int i{ 0 }; i < (m_Width * m_Height); ++i)
-			m_pDepthBufferPixels[i] = FLT_MAX;
+			//NORMALS, TANGENTS & VIEW DIRECTION get normalized, multiplying them with w first wouldn't change a thing
+			if constexpr (usesNormal)
+			{
+				pixelOut.normal = { attributes.normal[0].Evaluate(offsetX, offsetY),
+					attributes.normal[1].Evaluate(offsetX, offsetY), attributes.normal[2].Evaluate(offsetX, offsetY) };
+				pixelOut.normal.Normalize();
+			}
 
-		m_AspectRatio = float(m_Width) / float(m_Height);
+			if constexpr (usesTangent)
+			{
+				pixelOut.tangent = { attributes.tangent[0].Evaluate(offsetX, offsetY),
+					attributes.tangent[1].Evaluate(offsetX, offsetY), attributes.tangent[2].Evaluate(offsetX, offsetY) };
+				pixelOut.tangent.Normalize();
+			}
+
+			if constexpr (usesViewDirection)
+			{
+				pixelOut.viewDirection = { attributes.viewDirection[0].Evaluate(offsetX, offsetY),
+					attributes.viewDirection[1].Evaluate(offsetX, offsetY), attributes.viewDirection[2].Evaluate(offsetX, offsetY) };
+				pixelOut.viewDirection.Normalize();
+			}
+
+			finalColor = PixelShading<shadingMode, useNormalMap>(pixelOut);
+		}
+		finalColor.MaxToOne();
 
-		m_pTexture = Texture::LoadFromFile("Resources/vehicle_diffuse.png");
-		m_pNormalMap = Texture::LoadFromFile("Resources/vehicle_normal.png");
-		m_pGlossinessMap = Texture::LoadFromFile("Resources/vehicle_gloss.png");
-		m_pSpecularMap = Texture::LoadFromFile("Resources/vehicle_specular.png");
+		return SDL_MapRGB(m_pBackBuffer->format,
+			static_cast<uint8_t>(finalColor.r * 255),
+			static_cast<uint8_t>(finalColor.g * 255),
+			static_cast<uint8_t>(finalColor.b * 255));
 	}
 
-	void Renderer::RenderSoftware() const
+	float Renderer::ToVisualizedDepth(float depth) const
 	{
-		SDL_LockSurface(m_pBackBuffer);
-		m_pVehicleMesh->m_VerticesOut.clear();
+		if (m_DepthFormat != Depth::D32_FLOAT_REVERSED)
+			return depth;
+
+		//Back to the depth the camera's own projection gives, so every format shows the same range.
+		//The unorm formats keep their steps, that's what the visualization is there to show.
+		const float nearPlane{ m_pCamera->nearPlane };
+		const float farPlane{ m_pCamera->farPlane };
+		return farPlane / (farPlane - nearPlane) * (1.f - depth);
+	}
 
-		VertexTransformationFunction(*m_pVehicleMesh);
+	float Renderer::GetStoredDepth(int px, int py) const
+	{
+		return Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+			{
+				using DepthTraits = decltype(depthTraits);
+				return DepthTraits::ToDepth(GetStoredKey<DepthTraits>(px, py));
+			});
+	}
 
-		std::vector<Vector2> verteciesRaster;
-		for (const auto& vertex : m_pVehicleMesh->m_VerticesOut)
-			verteciesRaster.push_back({ (vertex.position.x + 1) / 2.0f * m_Width,
-					(1.0f - vertex.position.y) / 2.0f * m_Height });
+	template<typename DepthTraits>
+	uint32_t Renderer::GetStoredKey(int px, int py) const
+	{
+		const int blockX{ px / Rasterizer::BLOCK_SIZE };
+		const int blockY{ py / Rasterizer::BLOCK_SIZE };
+		const CompressedDepth::Block& block{ m_pCompressedDepth->GetBlock(blockX, blockY) };
+		switch (block.state)
+		{
+		case CompressedDepth::CLEARED:
+			return DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE);
+		case CompressedDepth::PLANE:
+			return DepthTraits::ToKey(block.GetDepth(px, py));
+		default:
+			return DepthTraits::FromStorage(GetDepthBuffer<DepthTraits>()[m_TiledLayout.GetPixelIndex(px, py)]);
+		}
+	}
 
-		//Clear depth buffer & background
-		for (int i{ 0 }; i < (m_Width * m_Height); ++i)
+	template<typename Shader>
+	void Renderer::SetupShadedMesh(const Mesh& mesh, const Shader& shader, std::vector<ShadedVertex<typename Shader::Varyings>>& vertices,
+		std::vector<ShadedTriangle<typename Shader::Varyings>>& triangles)
+	{
+		vertices.resize(mesh.m_SoftwareVertives.size());
+		for (size_t vertexIndex{ 0 }; vertexIndex < vertices.size(); ++vertexIndex)
 		{
-			m_pDepthBufferPixels[i] = FLT_MAX;
-			if (!m_UseUniformBackground)
-			m_pBackBufferPixels[i] = SDL_MapRGB(m_pBackBuffer->format,
-				static_cast<uint8_t>(0.39f * 255),
-				static_cast<uint8_t>(0.39f * 255),
-				static_cast<uint8_t>(0.39f * 255));
-			else
-				m_pBackBufferPixels[i] = SDL_MapRGB(m_pBackBuffer->format,
-					static_cast<uint8_t>(0.1f * 255),
-					static_cast<uint8_t>(0.1f * 255),
-					static_cast<uint8_t>(0.1f * 255));
+			ShadedVertex<typename Shader::Varyings>& vertex{ vertices[vertexIndex] };
+			vertex.clipPosition = shader.VertexShader(mesh.m_SoftwareVertives[vertexIndex], vertex.varyings);
+			vertex.clipCode = Clipper::ComputeClipCode(vertex.clipPosition, m_GuardBand);
+			vertex.screenPosition = (vertex.clipCode & Clipper::CLIP_NEAR) ? Vector4{} : ToScreenPosition(vertex.clipPosition);
 		}
 
-		assert(m_pVehicleMesh->m_VerticesOut.size() % 3 == 0);
-		//Check if the number of vertecies is divisible by 3.
-		//If not then there is an issue with our triangles
+		using Varyings = typename Shader::Varyings;
+		using Layout = VaryingLayout<Varyings>;
+		auto addTriangle = [&](uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2)
+		{
+			//Not counted in the frame stats, those are the vehicle's
+			ShadedTriangle<Varyings> shadedTriangle{};
+			if (SetupTriangle(vertices[vertexIndex0].screenPosition, vertices[vertexIndex1].screenPosition, vertices[vertexIndex2].screenPosition,
+				mesh.GetCullMode(), vertexIndex0, vertexIndex1, vertexIndex2, shadedTriangle.triangle) != SETUP_DONE)
+				return;
+
+			//Setup might have swapped two vertices to make the triangle clockwise
+			const uint32_t* const pVertexIndices{ shadedTriangle.triangle.vertexIndices };
+			shadedTriangle.SetupVaryings(vertices[pVertexIndices[0]], vertices[pVertexIndices[1]], vertices[pVertexIndices[2]]);
+			triangles.push_back(shadedTriangle);
+		};
+
+		//Same as AddClippedVertex, the varyings are linear in clip space too
+		auto addClippedVertex = [&](uint32_t insideIndex, uint32_t outsideIndex, float factor)
+		{
+			const ShadedVertex<Varyings>& inside{ vertices[insideIndex] };
+			const ShadedVertex<Varyings>& outside{ vertices[outsideIndex] };
+			ShadedVertex<Varyings> vertex{};
+			vertex.clipPosition = inside.clipPosition + (outside.clipPosition - inside.clipPosition) * factor;
+			vertex.clipCode = Clipper::ComputeClipCode(vertex.clipPosition, m_GuardBand);
+			vertex.screenPosition = ToScreenPosition(vertex.clipPosition);
+
+			const typename Layout::Floats insideFloats{ Layout::ToFloats(inside.varyings) };
+			const typename Layout::Floats outsideFloats{ Layout::ToFloats(outside.varyings) };
+			typename Layout::Floats floats{};
+			for (int i{ 0 }; i < Layout::NUM_FLOATS; ++i)
+				floats[i] = insideFloats[i] + (outsideFloats[i] - insideFloats[i]) * factor;
+			vertex.varyings = Layout::FromFloats(floats);
+
+			vertices.push_back(vertex);
+			return static_cast<uint32_t>(vertices.size() - 1);
+		};
+
+		triangles.clear();
+		triangles.reserve(mesh.m_Indices.size() / 3);
+		const uint16_t cullPlanes{ static_cast<uint16_t>(m_DepthFormat == Depth::D32_FLOAT_REVERSED ? ~Clipper::CLIP_FAR : ~0) };
+		for (size_t index{ 0 }; index + 2 < mesh.m_Indices.size(); index += 3)
+		{
+			const uint32_t vertexIndex0{ mesh.m_Indices[index] };
+			const uint32_t vertexIndex1{ mesh.m_Indices[index + 1] };
+			const uint32_t vertexIndex2{ mesh.m_Indices[index + 2] };
+			const uint16_t clipCode0{ vertices[vertexIndex0].clipCode };
+			const uint16_t clipCode1{ vertices[vertexIndex1].clipCode };
+			const uint16_t clipCode2{ vertices[vertexIndex2].clipCode };
 
-		//Use this for triangle strip.
-		//for (int startVertexIndex{ 0 }; startVertexIndex < m_pVehicleMesh->m_Indices.size() - 2; ++startVertexIndex)
-			//RenderTriangle(*m_pVehicleMesh, verteciesRaster, startVertexIndex, startVertexIndex % 2);
-		for (int vertexIndex{ 0 }; vertexIndex < m_pVehicleMesh->m_Indices.size(); vertexIndex += 3)
-			RenderTriangle(*m_pVehicleMesh, verteciesRaster, vertexIndex, false);
+			if (clipCode0 & clipCode1 & clipCode2 & cullPlanes)
+				continue;
 
-		SDL_UnlockSurface(m_pBackBuffer);
-		SDL_BlitSurface(m_pBackBuffer, 0, m_pFrontBuffer, 0);
-		SDL_UpdateWindowSurface(m_pWindow);
+			if (!((clipCode0 | clipCode1 | clipCode2) & (Clipper::CLIP_NEAR | Clipper::GUARD_BAND_PLANES)))
+			{
+				addTriangle(vertexIndex0, vertexIndex1, vertexIndex2);
+				continue;
+			}
+
+			//The same clipper as the vehicle, the new vertices go after the mesh's own
+			uint32_t polygon[Clipper::MAX_POLYGON_VERTICES]{ vertexIndex0, vertexIndex1, vertexIndex2 };
+			const int numVertices{ Clipper::ClipPolygon(polygon, 3, m_GuardBand,
+				[&](uint32_t vertexIndex) { return vertices[vertexIndex].clipPosition; }, addClippedVertex) };
+			for (int i{ 1 }; i < numVertices - 1; ++i)
+				addTriangle(polygon[0], polygon[i], polygon[i + 1]);
+		}
 	}
 
-	void Renderer::RenderTriangle(const Mesh& mesh, const std::vector<Vector2>& verteciesRaster,
-		int vertexIndex, bool swapVertex) const
+	template<typename Shader>
+	void Renderer::DrawShadedTile(int tileIndex, const Shader& shader, const std::vector<ShadedTriangle<typename Shader::Varyings>>& triangles)
 	{
-		const size_t vertexIndex0{ mesh.m_Indices[vertexIndex + (2 * swapVertex)] };
-		const size_t vertexIndex1{ mesh.m_Indices[vertexIndex + 1] };
-		const size_t vertexIndex2{ mesh.m_Indices[vertexIndex + (!swapVertex * 2)] };
-
-		// Make sure the triangle doesn't have the same vertex twice. If it does it's got no area so we don't have to render it.
-		if (vertexIndex0 == vertexIndex1 || vertexIndex1 == vertexIndex2 || vertexIndex2 == vertexIndex0)
-			return;
+		const Rasterizer::PixelBounds tileBounds{ GetTileBounds(tileIndex) };
+		const bool isDepthCleared{ m_TileClearStates[tileIndex].isDepthCleared };
+		Depth::Dispatch(m_DepthFormat, [&](auto depthTraits)
+			{
+				using DepthTraits = decltype(depthTraits);
+				for (const ShadedTriangle<typename Shader::Varyings>& shadedTriangle : triangles)
+				{
+					const Rasterizer::Triangle& triangle{ shadedTriangle.triangle };
+					Rasterizer::PixelBounds bounds{};
+					bounds.min = { std::max(triangle.bounds.min.x, tileBounds.min.x), std::max(triangle.bounds.min.y, tileBounds.min.y) };
+					bounds.max = { std::min(triangle.bounds.max.x, tileBounds.max.x), std::min(triangle.bounds.max.y, tileBounds.max.y) };
+					if (bounds.min.x >= bounds.max.x || bounds.min.y >= bounds.max.y)
+						continue;
+
+					const Rasterizer::EdgeFunction& edge0{ triangle.edges[0] };
+					const Rasterizer::EdgeFunction& edge1{ triangle.edges[1] };
+					const Rasterizer::EdgeFunction& edge2{ triangle.edges[2] };
+					const int startX{ Rasterizer::PixelCenter(bounds.min.x) };
+					const int startY{ Rasterizer::PixelCenter(bounds.min.y) };
+					int64_t rowWeight0{ edge0.Evaluate(startX, startY) + edge0.bias };
+					int64_t rowWeight1{ edge1.Evaluate(startX, startY) + edge1.bias };
+					int64_t rowWeight2{ edge2.Evaluate(startX, startY) + edge2.bias };
+
+					for (int py{ bounds.min.y }; py < bounds.max.y; ++py)
+					{
+						int64_t edgeWeight0{ rowWeight0 };
+						int64_t edgeWeight1{ rowWeight1 };
+						int64_t edgeWeight2{ rowWeight2 };
+
+						rowWeight0 += edge0.StepY();
+						rowWeight1 += edge1.StepY();
+						rowWeight2 += edge2.StepY();
+
+						const float rowDepth{ triangle.depth.Evaluate(0, py - triangle.bounds.min.y) };
+						for (int px{ bounds.min.x }; px < bounds.max.x; ++px,
+							edgeWeight0 += edge0.StepX(), edgeWeight1 += edge1.StepX(), edgeWeight2 += edge2.StepX())
+						{
+							if ((edgeWeight0 | edgeWeight1 | edgeWeight2) < 0)
+								continue;
+
+							const float interpolatedDepth{ rowDepth + triangle.depth.stepX * (px - triangle.bounds.min.x) };
+							if (interpolatedDepth < 0.f || interpolatedDepth > 1.f)
+								continue;
+
+							//Less, like the depth stencil state of the effect. Nothing gets written, blended triangles don't hide each other.
+							const uint32_t storedKey{ isDepthCleared ? DepthTraits::FromStorage(DepthTraits::CLEAR_VALUE) : GetStoredKey<DepthTraits>(px, py) };
+							if (DepthTraits::ToKey(interpolatedDepth) >= storedKey)
+								continue;
+
+							const PixelOutput output{ shader.PixelShader(shadedTriangle.Interpolate(px, py)) };
+
+							//Source alpha over the resolved color
+							uint32_t& pixel{ m_pBackBufferPixels[py * m_Width + px] };
+							uint8_t r{}, g{}, b{};
+							SDL_GetRGB(pixel, m_pBackBuffer->format, &r, &g, &b);
+							constexpr float inverseClampedValue{ 1 / 255.f };
+							const ColorRGB destination{ r * inverseClampedValue, g * inverseClampedValue, b * inverseClampedValue };
+							ColorRGB blended{ output.color * output.alpha + destination * (1.f - output.alpha) };
+							blended.MaxToOne();
+							pixel = SDL_MapRGB(m_pBackBuffer->format,
+								static_cast<uint8_t>(blended.r * 255),
+								static_cast<uint8_t>(blended.g * 255),
+								static_cast<uint8_t>(blended.b * 255));
+						}
+					}
+				}
+			});
+	}
 
-		const Vector2 vertex0{ verteciesRaster[vertexIndex0] };
-		const Vector2 vertex1{ verteciesRaster[vertexIndex1] };
-		const Vector2 vertex2{ verteciesRaster[vertexIndex2] };
+	template<Renderer::ShadingMode shadingMode, bool useNormalMap>
+	ColorRGB Renderer::PixelShading(const Vertex_Out& vertex) const
+	{
+		//Parameters
+		const Vector3 lightDirection = { .577f, -.577f, .577f };
+		constexpr float kd{ 1.f }; //Diffuse Reflection Coefficient
+		constexpr float lightIntensity{ 7.f };
+		constexpr float shininess{ SHININESS };
 
-		const Vector2 vertex0NDC = { mesh.m_VerticesOut[vertexIndex0].position.x, mesh.m_VerticesOut[vertexIndex0].position.y };
-		const Vector2 vertex1NDC = { mesh.m_VerticesOut[vertexIndex1].position.x, mesh.m_VerticesOut[vertexIndex1].position.y };
-		const Vector2 vertex2NDC = { mesh.m_VerticesOut[vertexIndex2].position.x, mesh.m_VerticesOut[vertexIndex2].position.y };
+		if constexpr (shadingMode == DIFFUSE)
+			return (m_pTexture->Sample(vertex.uv) * kd) / PI;
+		else if constexpr (shadingMode == SPECULAR)
+			return ColorRGB{ 1,1,1 } * m_pSpecularMap->Sample(vertex.uv).r;
+		else
+		{
+			Vector3 normal{ vertex.normal };
+			if constexpr (useNormalMap)
+			{
+				const Matrix tangentSpaceMatrix{ vertex.tangent, Vector3::Cross(vertex.normal, vertex.tangent), vertex.normal, Vector3::Zero };
+				const ColorRGB normalColour = m_pNormalMap->Sample(vertex.uv);
 
-		if (vertex0NDC.x < -1.f || vertex0NDC.x > 1.f ||
-			vertex0NDC.y < -1.f || vertex0NDC.y > 1.f ||
-			vertex1NDC.x < -1.f || vertex1NDC.x > 1.f ||
-			vertex1NDC.y < -1.f || vertex1NDC.y > 1.f ||
-			vertex2NDC.x < -1.f || vertex2NDC.x > 1.f ||
-			vertex2NDC.y < -1.f || vertex2NDC.y > 1.f) return;
+				Vector3 normalMap{ normalColour.r, normalColour.g, normalColour.b };
+				normalMap = 2.f * normalMap - Vector3{ 1,1,1 };
+				normal = tangentSpaceMatrix.TransformVector(normalMap);
+			}
 
-		// Define the Bounding Box
-		Vector2 bottomLeft{ Vector2::SmallestVectorComponents(vertex0,Vector2::SmallestVectorComponents(vertex1,vertex2)) };
-		Vector2 topRight{ Vector2::BiggestVectorComponents(vertex0,Vector2::BiggestVectorComponents(vertex1,vertex2)) };
+			float observedArea = Vector3::Dot(normal, -lightDirection);
+			observedArea = std::max(observedArea, 0.f);
+			if constexpr (shadingMode == OBSERVED_AREA)
+				return ColorRGB{ 1,1,1 } * observedArea;
+			else
+			{
+				const ColorRGB lambert{ (m_pTexture->Sample(vertex.uv) * kd) / PI };
+				const float glossiness = m_pGlossinessMap->Sample(vertex.uv).r * shininess;
+				const float specular = m_pSpecularMap->Sample(vertex.uv).r;
+
+				const Vector3 reflect = Vector3::Reflect(-lightDirection, normal);
+				const float alfa = Vector3::Dot(reflect, vertex.viewDirection);
+				float PSR{};
+				if (alfa >= 0)
+					PSR = specular * (powf(alfa, glossiness));
+
+				const ColorRGB phong{ PSR, PSR, PSR };
+				return lambert * lightIntensity * observedArea + phong;
+			}
+		}
+	}
 
-		// Add the margin to fix the black lines between the triangles
-		constexpr float margin{ 1.f };
-		bottomLeft -= {margin, margin};
-		topRight += {margin, margin};
+	void Renderer::VertexTransformationFunction(Mesh& mesh)
+	{
+		const Matrix worldViewProjectionMatrix{ mesh.worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix };
 
-		Utils::Clamp(bottomLeft.x, 0, float(m_Width) - 1);
-		Utils::Clamp(topRight.x, 0, float(m_Width) - 1);
-		Utils::Clamp(bottomLeft.y, 0, float(m_Height) - 1);
-		Utils::Clamp(topRight.y, 0, float(m_Height) - 1);
+		//Written in place, after the first frame this never allocates. Also drops the vertices the clipper added last frame.
+		const size_t numVertices{ mesh.m_SoftwareVertives.size() };
+		mesh.m_VerticesOut.Resize(numVertices);
 
-		ColorRGB finalColor{};
-		for (int px{ int(bottomLeft.x) }; px < int(topRight.x); ++px)
-		{
-			for (int py{ int(bottomLeft.y) }; py < int(topRight.y); ++py)
+		//Every job gets a whole number of SIMD batches, only the last one has a scalar tail
+		const uint32_t numJobs{ static_cast<uint32_t>((numVertices + VERTICES_PER_JOB - 1) / VERTICES_PER_JOB) };
+		m_pThreadPool->ParallelFor(numJobs, [&](uint32_t jobIndex)
 			{
-				const Vector2 currentPixel{ static_cast<float>(px),static_cast<float>(py) };
-				const int pixelIdx{ px + py * m_Width };
+				const size_t firstVertex{ jobIndex * VERTICES_PER_JOB };
+				const size_t lastVertex{ std::min(firstVertex + VERTICES_PER_JOB, numVertices) };
 
-				if (m_CurrentRenderMode == BOUNDING_BOX)
-				{
-					finalColor = ColorRGB{ 1, 1, 1 };
+				size_t vertexIndex{ firstVertex };
+				if (m_RasterKernel != Rasterizer::SCALAR)
+					vertexIndex = TransformVerticesSSE2(mesh, worldViewProjectionMatrix, firstVertex, lastVertex);
 
-					m_pBackBufferPixels[pixelIdx] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
+				TransformVerticesScalar(mesh, worldViewProjectionMatrix, vertexIndex, lastVertex);
+			});
+	}
 
-					continue;
-				}
+	void Renderer::TransformVerticesScalar(Mesh& mesh, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const
+	{
+		TransformedVertices& vertices{ mesh.m_VerticesOut };
 
-				if (Utils::IsInTriangle(currentPixel, vertex0, vertex1, vertex2))
-				{
-					float weight0 = Vector2::Cross(currentPixel - vertex1, vertex1 - vertex2);
-					float weight1 = Vector2::Cross(currentPixel - vertex2, vertex2 - vertex0);
-					float weight2 = Vector2::Cross(currentPixel - vertex0, vertex0 - vertex1);
-
-					const float totalTriangleArea{ Vector2::Cross(vertex1 - vertex0,vertex2 - vertex0) };
-					const float invTotalTriangleArea{ 1 / totalTriangleArea };
-					weight0 *= invTotalTriangleArea;
-					weight1 *= invTotalTriangleArea;
-					weight2 *= invTotalTriangleArea;
-
-					const float depth0{ (mesh.m_VerticesOut[vertexIndex0].position.z) };
-					const float depth1{ (mesh.m_VerticesOut[vertexIndex1].position.z) };
-					const float depth2{ (mesh.m_VerticesOut[vertexIndex2].position.z) };
-					const float interpolatedDepth{ 1.f /
-							(weight0 * (1.f / depth0) +
-							weight1 * (1.f / depth1) +
-							weight2 * (1.f / depth2)) };
-
-					if (m_pDepthBufferPixels[pixelIdx] < interpolatedDepth ||
-						interpolatedDepth < 0.f || interpolatedDepth > 1.f) continue;
-
-					m_pDepthBufferPixels[pixelIdx] = interpolatedDepth;
-
-					const float wDepth0{ mesh.m_VerticesOut[vertexIndex0].position.w };
-					const float wDepth1{ mesh.m_VerticesOut[vertexIndex1].position.w };
-					const float wDepth2{ mesh.m_VerticesOut[vertexIndex2].position.w };
-
-					const float wInterpolated{ 1.f /
-						(weight0 * (1.f / wDepth0) +
-						weight1 * (1.f / wDepth1) +
-						weight2 * (1.f / wDepth2)) };
-
-					//UVs
-					const Vector2 vertex0UV{ mesh.m_VerticesOut[vertexIndex0].uv / mesh.m_VerticesOut[vertexIndex0].position.w };
-					const Vector2 vertex1UV{ mesh.m_VerticesOut[vertexIndex1].uv / mesh.m_VerticesOut[vertexIndex1].position.w };
-					const Vector2 vertex2UV{ mesh.m_VerticesOut[vertexIndex2].uv / mesh.m_VerticesOut[vertexIndex2].position.w };
-					Vector2 UVInterpolated{ (vertex0UV * weight0 + vertex1UV * weight1 + vertex2UV * weight2) * wInterpolated };
-					UVInterpolated.y = std::max(UVInterpolated.y, 0.f);
-					UVInterpolated.x = std::max(UVInterpolated.x, 0.f);
-
-					//NORMALS
-					const Vector3 vertex0Normal{ mesh.m_VerticesOut[vertexIndex0].normal / mesh.m_VerticesOut[vertexIndex0].position.w };
-					const Vector3 vertex1Normal{ mesh.m_VerticesOut[vertexIndex1].normal / mesh.m_VerticesOut[vertexIndex1].position.w };
-					const Vector3 vertex2Normal{ mesh.m_VerticesOut[vertexIndex2].normal / mesh.m_VerticesOut[vertexIndex2].position.w };
-					Vector3 normalInterpolated{ (vertex0Normal * weight0 + vertex1Normal * weight1 + vertex2Normal * weight2) * wInterpolated };
-					normalInterpolated.Normalize();
-
-					//TANGENTS
-					const Vector3 vertex0Tangent{ mesh.m_VerticesOut[vertexIndex0].tangent / mesh.m_VerticesOut[vertexIndex0].position.w };
-					const Vector3 vertex1Tangent{ mesh.m_VerticesOut[vertexIndex1].tangent / mesh.m_VerticesOut[vertexIndex1].position.w };
-					const Vector3 vertex2Tangent{ mesh.m_VerticesOut[vertexIndex2].tangent / mesh.m_VerticesOut[vertexIndex2].position.w };
-					Vector3 tangentInterpolated{ (vertex0Tangent * weight0 + vertex1Tangent * weight1 + vertex2Tangent * weight2) * wInterpolated };
-					tangentInterpolated.Normalize();
-
-					//VIEW DIRECTION
-					const Vector3 vertex0ViewDirection{ mesh.m_VerticesOut[vertexIndex0].viewDirection / mesh.m_VerticesOut[vertexIndex0].position.w };
-					const Vector3 vertex1ViewDirection{ mesh.m_VerticesOut[vertexIndex1].viewDirection / mesh.m_VerticesOut[vertexIndex1].position.w };
-					const Vector3 vertex2ViewDirection{ mesh.m_VerticesOut[vertexIndex2].viewDirection / mesh.m_VerticesOut[vertexIndex2].position.w };
-					Vector3 viewDirectionInterpolated{ (vertex0ViewDirection * weight0 + vertex1ViewDirection * weight1 + vertex2ViewDirection * weight2) * wInterpolated };
-					viewDirectionInterpolated.Normalize();
-
-					Vertex_Out pixelOut{};
-					pixelOut.uv = UVInterpolated;
-					pixelOut.normal = normalInterpolated;
-					pixelOut.tangent = tangentInterpolated;
-					pixelOut.viewDirection = viewDirectionInterpolated;
-
-					auto remap = [](float value, float min, float max)
-					{
-						return (value - min) / (max - min);
-					};
+		for (size_t vertexIndex{ firstVertex }; vertexIndex < lastVertex; ++vertexIndex)
+		{
+			const Vertex& vertex{ mesh.m_SoftwareVertives[vertexIndex] };
 
-					const float remappedResult = remap(interpolatedDepth, 0.995f, 1.f);
+			const Vector4 clipPosition{ worldViewProjectionMatrix.TransformPoint({ vertex.position, 1.f }) };
 
-					//Update Color in Buffer
-					switch (m_CurrentRenderMode)
-					{
-					case TEXTURE:
-						//finalColor = m_pTexture->Sample(UVInterpolated);
-						finalColor = PixelShading(pixelOut);
-						break;
-					case BOUNDING_BOX:
-						break;
-					case DEPTH_VALUES:
-						finalColor = { remappedResult, remappedResult,remappedResult };
-						break;
+			//The clipper works in clip space, every triangle using a vertex behind the near plane goes through it
+			const uint16_t clipCode{ Clipper::ComputeClipCode(clipPosition, m_GuardBand) };
+			vertices.clipPositions[vertexIndex] = clipPosition;
+			vertices.clipCodes[vertexIndex] = clipCode;
 
-					}
-					finalColor.MaxToOne();
+			//Perspetive Divide, only for the vertices in front of the camera. The others only get read by the clipper.
+			vertices.screenPositions[vertexIndex] = (clipCode & Clipper::CLIP_NEAR) ? Vector4{} : ToScreenPosition(clipPosition);
 
-					m_pBackBufferPixels[px + (py * m_Width)] = SDL_MapRGB(m_pBackBuffer->format,
-						static_cast<uint8_t>(finalColor.r * 255),
-						static_cast<uint8_t>(finalColor.g * 255),
-						static_cast<uint8_t>(finalColor.b * 255));
-				}
-			}
+			vertices.uvs[vertexIndex] = vertex.uv;
+
+			//Transform the normals to world space
+			vertices.normals[vertexIndex] = mesh.worldMatrix.TransformVector(vertex.normal).Normalized();
+			vertices.tangents[vertexIndex] = mesh.worldMatrix.TransformVector(vertex.tangent);
+
+			Vector3 viewDirection{ mesh.worldMatrix.TransformPoint(vertex.position) - m_pCamera->origin };
+			viewDirection.Normalize();
+			vertices.viewDirections[vertexIndex] = viewDirection;
 		}
 	}
 
-	ColorRGB Renderer::PixelShading(const Vertex_Out& vertex) const
+	size_t Renderer::TransformVerticesSSE2(Mesh& mesh, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const
 	{
-		//Parameters
-		const Vector3 lightDirection = { .577f, -.577f, .577f };
-		constexpr float kd{ 1.f }; //Diffuse Reflection Coefficient
-		constexpr float lightIntensity{ 7.f };
-		constexpr float shininess{ 25.f };
-
-		const ColorRGB lambert{ (m_pTexture->Sample(vertex.uv) * kd) / PI };;
-			if (m_CurrentShadingMode == ShadingMode::DIFFUSE) return lambert;
-		const Matrix tangentSpaceMatrix{ vertex.tangent, Vector3::Cross(vertex.normal, vertex.tangent), vertex.normal, Vector3::Zero };
-		ColorRGB normalColour = m_pNormalMap->Sample(vertex.uv);
-
-		Vector3 normalMap{ normalColour.r, normalColour.g, normalColour.b };
-		normalMap = 2.f * normalMap - Vector3{ 1,1,1 };
+		constexpr size_t batchSize{ 4 };
 
-		normalMap = tangentSpaceMatrix.TransformVector(normalMap);
-			if (!m_UseNormalMap) normalMap = vertex.normal;
+		TransformedVertices& vertices{ mesh.m_VerticesOut };
 
-		float observedArea = Vector3::Dot(normalMap, -lightDirection);
-		observedArea = std::max(observedArea, 0.f);
-			if (m_CurrentShadingMode == ShadingMode::OBSERVED_AREA) return ColorRGB{ 1,1,1 } * observedArea;
-		float glossiness = m_pGlossinessMap->Sample(vertex.uv).r;
-		float specular = m_pSpecularMap->Sample(vertex.uv).r;
-			if (m_CurrentShadingMode == ShadingMode::SPECULAR) return ColorRGB{ 1,1,1 } * specular;
+		//Every matrix element gets its own register, a component of the whole batch is then a few multiplies and adds.
+		//Same order of operations as Matrix::TransformPoint, so the result is exactly the scalar one.
+		struct BroadcastMatrix
+		{
+			__m128 elements[4][4];
 
-		glossiness *= shininess;
+			explicit BroadcastMatrix(const Matrix& matrix)
+			{
+				for (int row{ 0 }; row < 4; ++row)
+					for (int column{ 0 }; column < 4; ++column)
+						elements[row][column] = _mm_set1_ps(matrix[row][column]);
+			}
 
-		const Vector3 reflect = Vector3::Reflect(-lightDirection, normalMap);
-		const float alfa = Vector3::Dot(reflect, vertex.viewDirection);
-		float PSR{};
-		if (alfa >= 0)
-			PSR = specular * (powf(alfa, glossiness));
+			__m128 TransformVector(__m128 x, __m128 y, __m128 z, int column) const
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_mul_ps(elements[0][column], x), _mm_mul_ps(elements[1][column], y)), _mm_mul_ps(elements[2][column], z));
+			}
 
-		const ColorRGB phong{ PSR, PSR, PSR };
-		if (m_CurrentShadingMode == ShadingMode::COMBINED)
-			return lambert * lightIntensity * observedArea + phong;
-	}
+			__m128 TransformPoint(__m128 x, __m128 y, __m128 z, int column) const
+			{
+				return _mm_add_ps(TransformVector(x, y, z, column), elements[3][column]);
+			}
+		};
+		const BroadcastMatrix worldViewProjection{ worldViewProjectionMatrix };
+		const BroadcastMatrix world{ mesh.worldMatrix };
+
+		const __m128 zero{ _mm_setzero_ps() };
+		const __m128 one{ _mm_set1_ps(1.f) };
+		const __m128 two{ _mm_set1_ps(2.f) };
+		const __m128 width{ _mm_set1_ps(static_cast<float>(m_Width)) };
+		const __m128 height{ _mm_set1_ps(static_cast<float>(m_Height)) };
+		const __m128 guardBandX{ _mm_set1_ps(m_GuardBand.x) };
+		const __m128 guardBandY{ _mm_set1_ps(m_GuardBand.y) };
+		const __m128 cameraX{ _mm_set1_ps(m_pCamera->origin.x) };
+		const __m128 cameraY{ _mm_set1_ps(m_pCamera->origin.y) };
+		const __m128 cameraZ{ _mm_set1_ps(m_pCamera->origin.z) };
+		const bool isDepthReversed{ m_DepthFormat == Depth::D32_FLOAT_REVERSED };
+		const __m128 nearPlane{ _mm_set1_ps(m_pCamera->nearPlane) };
+
+		auto normalize = [](__m128& x, __m128& y, __m128& z)
+		{
+			const __m128 magnitude{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))) };
+			x = _mm_div_ps(x, magnitude);
+			y = _mm_div_ps(y, magnitude);
+			z = _mm_div_ps(z, magnitude);
+		};
 
-	void Renderer::VertexTransformationFunction(Mesh& mesh) const
-	{
-		const Matrix worldViewMatrix = mesh.worldMatrix * m_pCamera->viewMatrix * m_pCamera->projectionMatrix;
+		auto clipBit = [](__m128 isOutside, uint16_t plane)
+		{
+			return _mm_and_si128(_mm_castps_si128(isOutside), _mm_set1_epi32(plane));
+		};
 
-		for (const auto& vertex : mesh.m_SoftwareVertives)
+		//A Vector3 is 12 bytes, so every store also writes the first float of the next vertex, which the next store then fixes
+		auto storeVector3 = [](Vector3* pDestination, __m128 x, __m128 y, __m128 z)
 		{
-			Vertex_Out vertexOut{ Vector4{}, vertex.color, vertex.uv, vertex.normal, vertex.tangent, vertex.viewDirection };
+			__m128 vertex0{ x }, vertex1{ y }, vertex2{ z }, vertex3{ _mm_setzero_ps() };
+			_MM_TRANSPOSE4_PS(vertex0, vertex1, vertex2, vertex3);
 
-			vertexOut.position = worldViewMatrix.TransformPoint({ vertex.position, 1.f });
+			float* pFloats{ &pDestination->x };
+			_mm_storeu_ps(pFloats, vertex0);
+			_mm_storeu_ps(pFloats + 3, vertex1);
+			_mm_storeu_ps(pFloats + 6, vertex2);
 
-			//Perspetive Divide
-			vertexOut.position.x /= vertexOut.position.w;
-			vertexOut.position.y /= vertexOut.position.w;
-			vertexOut.position.z /= vertexOut.position.w;
+			//The vertex after the batch might belong to another job, the last one can't spill
+			_mm_storel_pi(reinterpret_cast<__m64*>(pFloats + 9), vertex3);
+			_mm_store_ss(pFloats + 11, _mm_movehl_ps(vertex3, vertex3));
+		};
 
-			//Transform the normals to world space
-			vertexOut.normal = mesh.worldMatrix.TransformVector(vertexOut.normal);
-			vertexOut.normal.Normalize();
+		auto storeVector4 = [](Vector4* pDestination, __m128 x, __m128 y, __m128 z, __m128 w)
+		{
+			_MM_TRANSPOSE4_PS(x, y, z, w);
 
-			vertexOut.tangent = mesh.worldMatrix.TransformVector(vertexOut.tangent);
+			float* pFloats{ &pDestination->x };
+			_mm_storeu_ps(pFloats, x);
+			_mm_storeu_ps(pFloats + 4, y);
+			_mm_storeu_ps(pFloats + 8, z);
+			_mm_storeu_ps(pFloats + 12, w);
+		};
 
-			vertexOut.viewDirection = mesh.worldMatrix.TransformPoint(vertex.position) - m_pCamera->origin;
-			vertexOut.viewDirection.Normalize();
+		size_t vertexIndex{ firstVertex };
+		for (; vertexIndex + batchSize <= lastVertex; vertexIndex += batchSize)
+		{
+			//The input is still one struct per vertex, so the batch gets gathered one component at a time
+			const Vertex* pVertex{ &mesh.m_SoftwareVertives[vertexIndex] };
+			auto gather = [pVertex](Vector3 Vertex::* member, int component)
+			{
+				return _mm_setr_ps((pVertex[0].*member)[component], (pVertex[1].*member)[component], (pVertex[2].*member)[component], (pVertex[3].*member)[component]);
+			};
+
+			const __m128 positionX{ gather(&Vertex::position, 0) };
+			const __m128 positionY{ gather(&Vertex::position, 1) };
+			const __m128 positionZ{ gather(&Vertex::position, 2) };
+
+			const __m128 clipX{ worldViewProjection.TransformPoint(positionX, positionY, positionZ, 0) };
+			const __m128 clipY{ worldViewProjection.TransformPoint(positionX, positionY, positionZ, 1) };
+			const __m128 clipZ{ worldViewProjection.TransformPoint(positionX, positionY, positionZ, 2) };
+			const __m128 clipW{ worldViewProjection.TransformPoint(positionX, positionY, positionZ, 3) };
+			storeVector4(&vertices.clipPositions[vertexIndex], clipX, clipY, clipZ, clipW);
+
+			//Same tests as Clipper::ComputeClipCode, every plane sets its bit in the lanes that are outside of it
+			const __m128 minusClipW{ _mm_sub_ps(zero, clipW) };
+			const __m128 guardX{ _mm_mul_ps(guardBandX, clipW) };
+			const __m128 guardY{ _mm_mul_ps(guardBandY, clipW) };
+			const __m128 isBehindNearPlane{ _mm_cmplt_ps(clipZ, zero) };
+
+			__m128i clipCodes{ _mm_or_si128(clipBit(_mm_cmplt_ps(clipX, minusClipW), Clipper::CLIP_LEFT), clipBit(_mm_cmpgt_ps(clipX, clipW), Clipper::CLIP_RIGHT)) };
+			clipCodes = _mm_or_si128(clipCodes, _mm_or_si128(clipBit(_mm_cmplt_ps(clipY, minusClipW), Clipper::CLIP_BOTTOM), clipBit(_mm_cmpgt_ps(clipY, clipW), Clipper::CLIP_TOP)));
+			clipCodes = _mm_or_si128(clipCodes, _mm_or_si128(clipBit(isBehindNearPlane, Clipper::CLIP_NEAR), clipBit(_mm_cmpgt_ps(clipZ, clipW), Clipper::CLIP_FAR)));
+			clipCodes = _mm_or_si128(clipCodes, _mm_or_si128(clipBit(_mm_cmplt_ps(clipX, _mm_sub_ps(zero, guardX)), Clipper::GUARD_LEFT), clipBit(_mm_cmpgt_ps(clipX, guardX), Clipper::GUARD_RIGHT)));
+			clipCodes = _mm_or_si128(clipCodes, _mm_or_si128(clipBit(_mm_cmplt_ps(clipY, _mm_sub_ps(zero, guardY)), Clipper::GUARD_BOTTOM), clipBit(_mm_cmpgt_ps(clipY, guardY), Clipper::GUARD_TOP)));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&vertices.clipCodes[vertexIndex]), _mm_packs_epi32(clipCodes, clipCodes));
+
+			//Perspective divide and viewport transform, the lanes behind the near plane are left at zero like the scalar path does
+			const __m128 ndcX{ _mm_div_ps(clipX, clipW) };
+			const __m128 ndcY{ _mm_div_ps(clipY, clipW) };
+			const __m128 screenX{ _mm_andnot_ps(isBehindNearPlane, _mm_mul_ps(_mm_div_ps(_mm_add_ps(ndcX, one), two), width)) };
+			const __m128 screenY{ _mm_andnot_ps(isBehindNearPlane, _mm_mul_ps(_mm_div_ps(_mm_sub_ps(one, ndcY), two), height)) };
+			const __m128 depth{ _mm_andnot_ps(isBehindNearPlane, _mm_div_ps(isDepthReversed ? nearPlane : clipZ, clipW)) };
+			storeVector4(&vertices.screenPositions[vertexIndex], screenX, screenY, depth, _mm_andnot_ps(isBehindNearPlane, clipW));
+
+			for (size_t i{ 0 }; i < batchSize; ++i)
+				vertices.uvs[vertexIndex + i] = pVertex[i].uv;
 
-			mesh.m_VerticesOut.push_back(vertexOut);
+			//Transform the normals to world space
+			const __m128 normalX{ gather(&Vertex::normal, 0) };
+			const __m128 normalY{ gather(&Vertex::normal, 1) };
+			const __m128 normalZ{ gather(&Vertex::normal, 2) };
+			__m128 worldNormalX{ world.TransformVector(normalX, normalY, normalZ, 0) };
+			__m128 worldNormalY{ world.TransformVector(normalX, normalY, normalZ, 1) };
+			__m128 worldNormalZ{ world.TransformVector(normalX, normalY, normalZ, 2) };
+			normalize(worldNormalX, worldNormalY, worldNormalZ);
+			storeVector3(&vertices.normals[vertexIndex], worldNormalX, worldNormalY, worldNormalZ);
+
+			const __m128 tangentX{ gather(&Vertex::tangent, 0) };
+			const __m128 tangentY{ gather(&Vertex::tangent, 1) };
+			const __m128 tangentZ{ gather(&Vertex::tangent, 2) };
+			storeVector3(&vertices.tangents[vertexIndex], world.TransformVector(tangentX, tangentY, tangentZ, 0),
+				world.TransformVector(tangentX, tangentY, tangentZ, 1), world.TransformVector(tangentX, tangentY, tangentZ, 2));
+
+			__m128 viewDirectionX{ _mm_sub_ps(world.TransformPoint(positionX, positionY, positionZ, 0), cameraX) };
+			__m128 viewDirectionY{ _mm_sub_ps(world.TransformPoint(positionX, positionY, positionZ, 1), cameraY) };
+			__m128 viewDirectionZ{ _mm_sub_ps(world.TransformPoint(positionX, positionY, positionZ, 2), cameraZ) };
+			normalize(viewDirectionX, viewDirectionY, viewDirectionZ);
+			storeVector3(&vertices.viewDirections[vertexIndex], viewDirectionX, viewDirectionY, viewDirectionZ);
 		}
+
+		return vertexIndex;
 	}
 
 
@@ -587,6 +2377,74 @@ namespace dae {
 		}
 	}
 
+	void Renderer::CycleCullMode()
+	{
+		switch (m_pVehicleMesh->GetCullMode())
+		{
+		case Mesh::BACK:
+			std::cout << "\033[1;35m(SOFTWARE) CullMode FRONT\033[0m" << std::endl;
+			m_pVehicleMesh->SetCullMode(Mesh::FRONT);
+			break;
+		case Mesh::FRONT:
+			std::cout << "\033[1;35m(SOFTWARE) CullMode NONE\033[0m" << std::endl;
+			m_pVehicleMesh->SetCullMode(Mesh::NONE);
+			break;
+		case Mesh::NONE:
+			std::cout << "\033[1;35m(SOFTWARE) CullMode BACK\033[0m" << std::endl;
+			m_pVehicleMesh->SetCullMode(Mesh::BACK);
+			break;
+		}
+	}
+
+	float Renderer::GetDepthCompressionRatio() const
+	{
+		const size_t bytesPerPixel{ Depth::GetBytesPerPixel(m_DepthFormat) };
+		const uint32_t numBlocks{ m_FrameStats.depthBlocksRaw + m_FrameStats.depthBlocksCleared + m_FrameStats.depthBlocksPlane };
+		const size_t uncompressedBytes{ numBlocks * Rasterizer::BLOCK_SIZE * Rasterizer::BLOCK_SIZE * bytesPerPixel };
+		const size_t compressedBytes{ m_FrameStats.depthBlocksRaw * CompressedDepth::GetBlockBytes(CompressedDepth::RAW, bytesPerPixel)
+			+ m_FrameStats.depthBlocksCleared * CompressedDepth::GetBlockBytes(CompressedDepth::CLEARED, bytesPerPixel)
+			+ m_FrameStats.depthBlocksPlane * CompressedDepth::GetBlockBytes(CompressedDepth::PLANE, bytesPerPixel) };
+		return compressedBytes > 0 ? static_cast<float>(uncompressedBytes) / static_cast<float>(compressedBytes) : 1.f;
+	}
+
+	void Renderer::SetDepthFormat(Depth::Format format)
+	{
+		m_DepthFormat = format;
+		m_ClearDepthKey = Depth::GetClearKey(format);
+		m_pHiZBuffer->SetFormat(format);
+	}
+
+	void Renderer::CycleDepthFormat()
+	{
+		SetDepthFormat(static_cast<Depth::Format>((m_DepthFormat + 1) % Depth::NUM_FORMATS));
+		std::cout << "\033[1;35m(SOFTWARE) DepthFormat " << Depth::GetFormatName(m_DepthFormat) << "\033[0m" << std::endl;
+	}
+
+	void Renderer::SetSampleCount(int sampleCount)
+	{
+		m_SampleCount = sampleCount;
+		m_pHiZBuffer->SetSampleCount(sampleCount);
+	}
+
+	void Renderer::CycleSampleCount()
+	{
+		SetSampleCount(m_SampleCount == Rasterizer::MAX_SAMPLES ? 1 : m_SampleCount * 2);
+		std::cout << "\033[1;35m(SOFTWARE) MSAA " << m_SampleCount << "X\033[0m" << std::endl;
+	}
+
+	void Renderer::SetTextureLayout(TexelImage::Layout layout)
+	{
+		m_TextureLayout = layout;
+		for (Texture* pTexture : { m_pTexture, m_pNormalMap, m_pGlossinessMap, m_pSpecularMap, m_pFireTexture })
+			pTexture->SetLayout(layout);
+	}
+
+	void Renderer::CycleTextureLayout()
+	{
+		SetTextureLayout(static_cast<TexelImage::Layout>((m_TextureLayout + 1) % TexelImage::NUM_LAYOUTS));
+		std::cout << "\033[1;35m(SOFTWARE) Texture Layout " << TexelImage::GetLayoutName(m_TextureLayout) << "\033[0m" << std::endl;
+	}
+
 	void Renderer::HandleInput(SDL_Event event)
 	{
 		if (event.type != SDL_KEYUP) return;
@@ -601,8 +2459,8 @@ namespace dae {
 		if (event.key.keysym.scancode == SDL_SCANCODE_F3)
 		{
 			if (m_IsUsingFireFX)
-				std::cout << "\033[1;32m(HARDWARE) Disabled FireFX\033[0m" << std::endl;
-			else std::cout << "\033[1;32m(HARDWARE) Enabled FireFX\033[0m" << std::endl;
+				std::cout << "\033[1;33m(SHARED) Disabled FireFX\033[0m" << std::endl;
+			else std::cout << "\033[1;33m(SHARED) Enabled FireFX\033[0m" << std::endl;
 			m_IsUsingFireFX = !m_IsUsingFireFX;
 		}
 		if (event.key.keysym.scancode == SDL_SCANCODE_F4)
@@ -642,6 +2500,8 @@ namespace dae {
 				std::cout << "\033[1;35m(SOFTWARE) Disabled Bounding Box\033[0m" << std::endl;
 			}
 		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_F9)
+			CycleCullMode();
 		if (event.key.keysym.scancode == SDL_SCANCODE_F10)
 		{
 			if (m_UseUniformBackground)
@@ -649,6 +2509,393 @@ namespace dae {
 			else std::cout << "\033[1;33m(SHARED) Enabled Uniform Background\033[0m" << std::endl;
 			m_UseUniformBackground = !m_UseUniformBackground;
 		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_Z)
+			CycleDepthFormat();
+		if (event.key.keysym.scancode == SDL_SCANCODE_P)
+		{
+			if (m_UseZPrepass)
+				std::cout << "\033[1;35m(SOFTWARE) Disabled Z-Prepass\033[0m" << std::endl;
+			else std::cout << "\033[1;35m(SOFTWARE) Enabled Z-Prepass\033[0m" << std::endl;
+			m_UseZPrepass = !m_UseZPrepass;
+		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_M)
+			CycleSampleCount();
+		if (event.key.keysym.scancode == SDL_SCANCODE_B)
+		{
+			if (m_UseWideShading)
+				std::cout << "\033[1;35m(SOFTWARE) Disabled 8 Wide Shading\033[0m" << std::endl;
+			else std::cout << "\033[1;35m(SOFTWARE) Enabled 8 Wide Shading\033[0m" << std::endl;
+			m_UseWideShading = !m_UseWideShading;
+		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_F)
+		{
+			if (m_UseFastMath)
+				std::cout << "\033[1;35m(SOFTWARE) Disabled Fast Math\033[0m" << std::endl;
+			else std::cout << "\033[1;35m(SOFTWARE) Enabled Fast Math\033[0m" << std::endl;
+			m_UseFastMath = !m_UseFastMath;
+		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_R)
+		{
+			//The report renders software frames into the window, the hardware mode would flicker between the two
+			if (m_IsUsingDX)
+				std::cout << "\033[1;35m(SOFTWARE) The Fast Math Error report only measures the software rasterizer, switch to it with F1\033[0m" << std::endl;
+			else ReportFastMathError();
+		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_T)
+			CycleTextureLayout();
+		if (event.key.keysym.scancode == SDL_SCANCODE_C)
+		{
+			if (m_UseDepthCompression)
+				std::cout << "\033[1;35m(SOFTWARE) Disabled Depth Compression\033[0m" << std::endl;
+			else std::cout << "\033[1;35m(SOFTWARE) Enabled Depth Compression\033[0m" << std::endl;
+			m_UseDepthCompression = !m_UseDepthCompression;
+		}
+		if (event.key.keysym.scancode == SDL_SCANCODE_V)
+		{
+			if (m_UseVisibilityBuffer)
+				std::cout << "\033[1;35m(SOFTWARE) Disabled Visibility Buffer\033[0m" << std::endl;
+			else std::cout << "\033[1;35m(SOFTWARE) Enabled Visibility Buffer\033[0m" << std::endl;
+			m_UseVisibilityBuffer = !m_UseVisibilityBuffer;
+		}
+	}
+
+	void Renderer::RunBenchmark()
+	{
+		constexpr int benchmarkFrames{ 100 };
+
+		std::cout << "\033[1;35m[Benchmark - SOFTWARE] " << m_Width << "x" << m_Height << ", "
+			<< benchmarkFrames << " frames per pass\033[0m" << std::endl;
+
+		//The benchmark can run before the first Update, so the matrices might not be calculated yet
+		m_pCamera->CalculateViewMatrix();
+		m_pCamera->CalculateProjectionMatrix();
+		m_pVehicleMesh->UpdateMeshMatrices(m_pCamera->viewMatrix * m_pCamera->projectionMatrix, m_pCamera->invViewMatrix);
+
+		const Rasterizer::Kernel previousKernel{ m_RasterKernel };
+		const bool previousHierarchicalRaster{ m_UseHierarchicalRaster };
+		const bool previousHiZ{ m_UseHiZ };
+		const bool previousVisibilityBuffer{ m_UseVisibilityBuffer };
+		const Vector3 previousCameraOrigin{ m_pCamera->origin };
+		const Depth::Format previousDepthFormat{ m_DepthFormat };
+		const bool previousDepthCompression{ m_UseDepthCompression };
+		const bool previousZPrepass{ m_UseZPrepass };
+		const int previousSampleCount{ m_SampleCount };
+		const bool previousFastMath{ m_UseFastMath };
+		const TexelImage::Layout previousTextureLayout{ m_TextureLayout };
+
+		//Texture layouts, sampled on their own and in a frame
+		for (int layout{ 0 }; layout < TexelImage::NUM_LAYOUTS; ++layout)
+		{
+			SetTextureLayout(static_cast<TexelImage::Layout>(layout));
+			RunTexelBenchmark(std::string{ "Texels, " } + TexelImage::GetLayoutName(m_TextureLayout));
+			RunBenchmarkPass(std::string{ "Textures " } + TexelImage::GetLayoutName(m_TextureLayout), benchmarkFrames);
+		}
+		SetTextureLayout(previousTextureLayout);
+
+		//Raster kernels, with the default camera
+		const Rasterizer::Kernel bestKernel{ Rasterizer::GetBestSupportedKernel() };
+		for (int kernel{ Rasterizer::SCALAR }; kernel <= bestKernel; ++kernel)
+		{
+			m_RasterKernel = static_cast<Rasterizer::Kernel>(kernel);
+			RunBenchmarkPass(Rasterizer::GetKernelName(m_RasterKernel), benchmarkFrames);
+		}
+		m_RasterKernel = bestKernel;
+
+		//Fast math, and what it does to the image
+		m_UseFastMath = false;
+		RunBenchmarkPass("Precise math", benchmarkFrames);
+		m_UseFastMath = true;
+		RunBenchmarkPass("Fast math", benchmarkFrames);
+		ReportFastMathError();
+		m_UseFastMath = false;
+
+		//Depth formats, the unorm ones move less memory per depth test
+		for (int format{ 0 }; format < Depth::NUM_FORMATS; ++format)
+		{
+			SetDepthFormat(static_cast<Depth::Format>(format));
+			RunBenchmarkPass(std::string{ Depth::GetFormatName(m_DepthFormat) } + ", " + std::to_string(Depth::GetBytesPerPixel(m_DepthFormat)) + " bytes per pixel", benchmarkFrames);
+		}
+		SetDepthFormat(Depth::D32_FLOAT);
+
+		//Depth compression, whole blocks covered by one triangle become planes
+		m_UseDepthCompression = true;
+		RunBenchmarkPass("Depth compression", benchmarkFrames);
+		m_UseDepthCompression = false;
+
+		//Multisampling, the most samples that still fit the frame budget
+		constexpr double frameBudgetMilliseconds{ 1000.0 / 60.0 };
+		int affordableSampleCount{ 0 };
+		for (int sampleCount{ 1 }; sampleCount <= Rasterizer::MAX_SAMPLES; sampleCount *= 2)
+		{
+			SetSampleCount(sampleCount);
+			if (RunBenchmarkPass("MSAA " + std::to_string(sampleCount) + "X", benchmarkFrames).frameMilliseconds <= frameBudgetMilliseconds)
+				affordableSampleCount = sampleCount;
+		}
+		SetSampleCount(1);
+		if (affordableSampleCount)
+			std::cout << "   \033[1;35mMSAA " << affordableSampleCount << "X fits the " << frameBudgetMilliseconds << " ms frame budget\033[0m" << std::endl;
+		else std::cout << "   \033[1;35mNot even 1X fits the " << frameBudgetMilliseconds << " ms frame budget\033[0m" << std::endl;
+
+		//Hierarchical depth, with the car turned so a good part of it is hidden behind the front
+		const Matrix previousWorldMatrix{ m_pVehicleMesh->worldMatrix };
+		m_pVehicleMesh->worldMatrix = Matrix::CreateRotationY(PI_DIV_4) * previousWorldMatrix;
+
+		m_UseHiZ = false;
+		RunBenchmarkPass("Turned, without hierarchical depth", benchmarkFrames);
+		m_UseHiZ = true;
+		RunBenchmarkPass("Turned, hierarchical depth", benchmarkFrames);
+
+		//Visibility buffer, every visible pixel gets shaded exactly once
+		m_UseVisibilityBuffer = false;
+		const uint64_t forwardShaderInvocations{ RunBenchmarkPass("Turned, forward shading", benchmarkFrames).shaderInvocations };
+		m_UseVisibilityBuffer = true;
+		const uint64_t visiblePixels{ RunBenchmarkPass("Turned, visibility buffer", benchmarkFrames).shaderInvocations };
+		m_UseVisibilityBuffer = false;
+
+		//Z-prepass, the same one shader invocation per visible pixel but without a visibility buffer
+		m_UseZPrepass = true;
+		const uint64_t prepassShaderInvocations{ RunBenchmarkPass("Turned, Z-prepass", benchmarkFrames).shaderInvocations };
+		m_UseDepthCompression = true;
+		RunBenchmarkPass("Turned, Z-prepass with depth compression", benchmarkFrames);
+		m_UseDepthCompression = false;
+		m_UseZPrepass = false;
+
+		std::cout << "   \033[1;35mForward shading: " << static_cast<float>(forwardShaderInvocations) / std::max(visiblePixels, uint64_t{ 1 })
+			<< " shader invocations per visible pixel, Z-prepass: " << static_cast<float>(prepassShaderInvocations) / std::max(visiblePixels, uint64_t{ 1 })
+			<< ", visibility buffer: 1\033[0m" << std::endl;
+
+		m_pVehicleMesh->worldMatrix = previousWorldMatrix;
+
+		//Hierarchical rasterization, with the camera close enough for the triangles to get large
+		m_pCamera->origin = { 0.f, 0.f, 30.f };
+		m_pCamera->CalculateViewMatrix();
+
+		m_UseHierarchicalRaster = false;
+		RunBenchmarkPass("Close-up, per pixel", benchmarkFrames);
+		m_UseHierarchicalRaster = true;
+		RunBenchmarkPass("Close-up, hierarchical", benchmarkFrames);
+
+		//Clipping, with the camera inside of the car so part of it is behind the near plane
+		m_pCamera->origin = { 0.f, 0.f, 44.f };
+		m_pCamera->CalculateViewMatrix();
+		RunBenchmarkPass("Near plane", benchmarkFrames);
+
+		m_RasterKernel = previousKernel;
+		m_UseHierarchicalRaster = previousHierarchicalRaster;
+		m_UseHiZ = previousHiZ;
+		m_UseVisibilityBuffer = previousVisibilityBuffer;
+		m_pCamera->origin = previousCameraOrigin;
+		m_pCamera->CalculateViewMatrix();
+		SetDepthFormat(previousDepthFormat);
+		m_UseDepthCompression = previousDepthCompression;
+		m_UseZPrepass = previousZPrepass;
+		SetSampleCount(previousSampleCount);
+		m_UseFastMath = previousFastMath;
+		SetTextureLayout(previousTextureLayout);
+	}
+
+	Renderer::BenchmarkResult Renderer::RunBenchmarkPass(const std::string& label, int numFrames)
+	{
+		constexpr int warmupFrames{ 10 };
+		for (int frame{ 0 }; frame < warmupFrames; ++frame)
+			RenderSoftware();
+
+		uint64_t pixelsRasterized{};
+		uint64_t trianglesOccluded{};
+		uint64_t pixelsShaded{};
+		double rasterSeconds{};
+		double vertexSeconds{};
+		uint64_t heapAllocations{};
+		const uint64_t benchmarkStart{ SDL_GetPerformanceCounter() };
+		for (int frame{ 0 }; frame < numFrames; ++frame)
+		{
+			RenderSoftware();
+			heapAllocations += m_FrameStats.heapAllocations;
+			pixelsRasterized += m_FrameStats.pixelsRasterized;
+			trianglesOccluded += m_FrameStats.trianglesOccluded;
+			pixelsShaded += m_FrameStats.pixelsShaded;
+			rasterSeconds += m_FrameStats.rasterSeconds;
+			vertexSeconds += m_FrameStats.vertexSeconds;
+		}
+		const double frameMilliseconds{ static_cast<double>(SDL_GetPerformanceCounter() - benchmarkStart) / SDL_GetPerformanceFrequency() / numFrames * 1000.0 };
+
+		std::cout << "   \033[1;35m" << label << ": "
+			<< pixelsRasterized / rasterSeconds / 1'000'000.0 << " Mpixels/s, "
+			<< rasterSeconds / numFrames * 1000.0 << " ms raster per frame, "
+			<< vertexSeconds / numFrames * 1000.0 << " ms vertex stage per frame, "
+			<< trianglesOccluded / numFrames << " occluded triangles, "
+			<< pixelsShaded / numFrames << " shader invocations per frame, "
+			<< frameMilliseconds << " ms per frame\033[0m" << std::endl;
+		std::cout << "      \033[1;35mTriangles inside: " << m_FrameStats.trianglesInside
+			<< ", in guard band: " << m_FrameStats.trianglesInGuardBand
+			<< ", clipped: " << m_FrameStats.trianglesClipped
+			<< ", frustum culled: " << m_FrameStats.trianglesFrustumCulled
+			<< ", face culled: " << m_FrameStats.trianglesFaceCulled
+			<< ", degenerate: " << m_FrameStats.trianglesDegenerate
+			<< ", too small: " << m_FrameStats.trianglesSmallCulled
+			<< ", rasterized: " << m_Triangles.size() << "\033[0m" << std::endl;
+		std::cout << "      \033[1;35mFrame arena: " << m_pFrameArena->GetUsedBytes() / 1024 << " of " << m_pFrameArena->GetCapacity() / 1024 << " KB used"
+			<< ", untouched tiles: " << m_FrameStats.tilesUntouched << " of " << m_TileBins.size();
+		if (AllocationCounter::IS_COUNTING)
+			std::cout << ", heap allocations: " << heapAllocations;
+		if (IsDepthCompressed())
+		{
+			std::cout << ", depth compression " << GetDepthCompressionRatio() << ":1 (" << m_FrameStats.depthBlocksPlane << " plane, "
+				<< m_FrameStats.depthBlocksCleared << " cleared, " << m_FrameStats.depthBlocksRaw << " raw blocks)";
+		}
+		if (m_SampleCount > 1)
+		{
+			//Only the color of a uniform block is stored once, depth takes every sample plane in every block
+			const uint32_t numSampleBlocks{ m_FrameStats.sampleBlocksUniform + m_FrameStats.sampleBlocksExpanded };
+			const float colorBytesPerPixel{ sizeof(uint32_t) * (m_FrameStats.sampleBlocksUniform + static_cast<float>(m_FrameStats.sampleBlocksExpanded) * m_SampleCount)
+				/ std::max(numSampleBlocks, 1u) };
+			std::cout << ", uniform MSAA blocks: " << m_FrameStats.sampleBlocksUniform << " of " << numSampleBlocks
+				<< ", sample bytes per pixel: " << colorBytesPerPixel << " color, " << Depth::GetBytesPerPixel(m_DepthFormat) * m_SampleCount << " depth";
+		}
+		std::cout << "\033[0m" << std::endl;
+
+		//After the warmup every buffer has its final size, so a steady frame shouldn't need the heap at all
+		assert(heapAllocations == 0 && "A steady-state software frame allocated from the heap");
+
+		return { pixelsShaded / numFrames, frameMilliseconds };
+	}
+
+	void Renderer::RunTexelBenchmark(const std::string& label) const
+	{
+		//Rows and columns: a square grid a texel apart at 1024x1024, walked the way a triangle that maps the texture
+		//straight or turned by 90 degrees would. Random: every sample somewhere else, the worst case for the cache.
+		constexpr int gridSize{ 512 };
+		constexpr int numSamples{ gridSize * gridSize };
+		constexpr int numRepetitions{ 8 };
+		constexpr float gridStep{ 1.f / (2.f * gridSize) };
+		std::vector<float> rowU(numSamples), rowV(numSamples), randomU(numSamples), randomV(numSamples);
+		uint32_t seed{ 12345 };
+		for (int sample{ 0 }; sample < numSamples; ++sample)
+		{
+			rowU[sample] = .25f + (sample % gridSize) * gridStep;
+			rowV[sample] = .25f + (sample / gridSize) * gridStep;
+
+			seed = seed * 1664525u + 1013904223u;
+			randomU[sample] = (seed >> 8) / static_cast<float>(1 << 24);
+			seed = seed * 1664525u + 1013904223u;
+			randomV[sample] = (seed >> 8) / static_cast<float>(1 << 24);
+		}
+
+		//Mtexels/s, with the sum of what got sampled kept so the loops can't be optimized away
+		float checksum{};
+		auto measure = [&](const std::vector<float>& u, const std::vector<float>& v, bool isWide)
+		{
+			const uint64_t start{ SDL_GetPerformanceCounter() };
+			for (int repetition{ 0 }; repetition < numRepetitions; ++repetition)
+			{
+				if (isWide)
+				{
+					__m256 sum{ _mm256_setzero_ps() };
+					for (int sample{ 0 }; sample < numSamples; sample += 8)
+					{
+						__m256 r{}, g{}, b{};
+						m_pTexture->Sample8(_mm256_loadu_ps(&u[sample]), _mm256_loadu_ps(&v[sample]), r, g, b);
+						sum = _mm256_add_ps(sum, _mm256_add_ps(r, _mm256_add_ps(g, b)));
+					}
+					alignas(32) float lanes[8];
+					_mm256_store_ps(lanes, sum);
+					for (const float lane : lanes)
+						checksum += lane;
+				}
+				else
+				{
+					for (int sample{ 0 }; sample < numSamples; ++sample)
+					{
+						const ColorRGB texel{ m_pTexture->Sample({ u[sample], v[sample] }) };
+						checksum += texel.r + texel.g + texel.b;
+					}
+				}
+			}
+			const double seconds{ static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency() };
+			return static_cast<double>(numSamples) * numRepetitions / seconds / 1'000'000.0;
+		};
+
+		//Sample8 gathers with AVX2, without it there is no 8 wide number
+		const bool hasAVX2{ Rasterizer::GetBestSupportedKernel() == Rasterizer::AVX2 };
+		auto measureWide = [&](const std::vector<float>& u, const std::vector<float>& v)
+		{
+			if (!hasAVX2)
+				return std::string{ "n/a" };
+
+			std::ostringstream throughput{};
+			throughput << measure(u, v, true);
+			return throughput.str();
+		};
+
+		//Swapping u and v walks the same grid down the columns
+		std::cout << "   \033[1;35m" << label << " in Mtexels/s, 1 and 8 wide. Rows: " << measure(rowU, rowV, false) << ", " << measureWide(rowU, rowV)
+			<< ", columns: " << measure(rowV, rowU, false) << ", " << measureWide(rowV, rowU)
+			<< ", random: " << measure(randomU, randomV, false) << ", " << measureWide(randomU, randomV)
+			<< " (checksum " << checksum << ")\033[0m" << std::endl;
+	}
+
+	void Renderer::ReportFastMathError()
+	{
+		//Nothing moves in between the two frames, only the shading math differs
+		const bool previousFastMath{ m_UseFastMath };
+		m_UseFastMath = false;
+		RenderSoftware();
+		const std::vector<uint32_t> precisePixels(m_pBackBufferPixels, m_pBackBufferPixels + m_Width * m_Height);
+		m_UseFastMath = true;
+		RenderSoftware();
+		const bool isFastMathActive{ m_BatchShader != &Renderer::ShadeBatchScalar };
+		m_UseFastMath = previousFastMath;
+
+		std::cout << "\033[1;35m[Fast Math Error - SOFTWARE] " << m_Width << "x" << m_Height << "\033[0m" << std::endl;
+		if (!isFastMathActive)
+		{
+			std::cout << "   \033[1;35mFast math is only in the 8 wide shading of the COMBINED shading mode, this frame doesn't use it\033[0m" << std::endl;
+			return;
+		}
+
+		//Pixels by their largest channel error: 1, 2, 3-4, 5-8, 9 and up
+		constexpr int numBuckets{ 5 };
+		constexpr int bucketLimits[numBuckets]{ 1, 2, 4, 8, 255 };
+		uint32_t bucketPixels[numBuckets]{};
+		uint32_t differingPixels{};
+		int maxChannelError{};
+		uint64_t sumAbsoluteError{};
+		uint64_t sumSquaredError{};
+		for (int pixel{ 0 }; pixel < m_Width * m_Height; ++pixel)
+		{
+			uint8_t precise[3]{}, fast[3]{};
+			SDL_GetRGB(precisePixels[pixel], m_pBackBuffer->format, &precise[0], &precise[1], &precise[2]);
+			SDL_GetRGB(m_pBackBufferPixels[pixel], m_pBackBuffer->format, &fast[0], &fast[1], &fast[2]);
+
+			int pixelError{};
+			for (int channel{ 0 }; channel < 3; ++channel)
+			{
+				const int error{ std::abs(precise[channel] - fast[channel]) };
+				pixelError = std::max(pixelError, error);
+				sumAbsoluteError += error;
+				sumSquaredError += error * error;
+			}
+			if (pixelError == 0)
+				continue;
+
+			++differingPixels;
+			maxChannelError = std::max(maxChannelError, pixelError);
+			int bucket{ 0 };
+			while (pixelError > bucketLimits[bucket])
+				++bucket;
+			++bucketPixels[bucket];
+		}
+
+		const int numChannels{ m_Width * m_Height * 3 };
+		const double meanSquaredError{ static_cast<double>(sumSquaredError) / numChannels };
+		std::cout << "   \033[1;35mDiffering pixels: " << differingPixels << " of " << m_Width * m_Height
+			<< ", max channel error: " << maxChannelError << "/255"
+			<< ", mean channel error: " << static_cast<double>(sumAbsoluteError) / numChannels << "/255";
+		if (meanSquaredError > 0.0)
+			std::cout << ", PSNR: " << 10.0 * std::log10(255.0 * 255.0 / meanSquaredError) << " dB";
+		std::cout << "\033[0m" << std::endl;
+		std::cout << "      \033[1;35mPixels off by 1: " << bucketPixels[0] << ", 2: " << bucketPixels[1] << ", 3-4: " << bucketPixels[2]
+			<< ", 5-8: " << bucketPixels[3] << ", 9 and up: " << bucketPixels[4] << "\033[0m" << std::endl;
 	}
 
 	void Renderer::SetRasterizerModel(bool isUsingDX)
@@ -1,8 +1,19 @@
 #pragma once
+#include <atomic>
 #include <map>
 
+#include "CompressedDepth.h"
+#include "DepthFormat.h"
 #include "Effect.h"
+#include "FrameArena.h"
 #include "Mesh.h"
+#include "ObjectPool.h"
+#include "Rasterizer.h"
+#include "SpecularTable.h"
+#include "TiledLayout.h"
+#include "EffectPosTex.h" //After Mesh.h, these expect dae to be in scope already
+#include "EffectTransparent.h"
+#include "FireShader.h"
 
 struct SDL_Window;
 struct SDL_Surface;
@@ -12,6 +23,9 @@ class Texture;
 
 namespace dae
 {
+	class ThreadPool;
+	class HiZBuffer;
+
 	class Renderer final
 	{
 	public:
@@ -40,14 +54,37 @@ namespace dae
 
 		void Update(const Timer* pTimer);
 		void RenderDirectX() const;
-		void RenderSoftware() const;
+		void RenderSoftware();
 
 		void SetRasterizerModel(bool isUsingDX);
 		void HandleInput(SDL_Event event);
 
+		//Renders the software path with every supported raster kernel and prints the throughput
+		void RunBenchmark();
+		struct BenchmarkResult
+		{
+			uint64_t shaderInvocations{}; //Per frame
+			double frameMilliseconds{}; //The whole software frame, resolve included
+		};
+		BenchmarkResult RunBenchmarkPass(const std::string& label, int numFrames);
+		//Samples the diffuse map without rendering, one texel at a time and 8 at a time
+		void RunTexelBenchmark(const std::string& label) const;
+		//1 (off), 2 or 4 samples per pixel
+		void SetSampleCount(int sampleCount);
+		//Renders the current frame with and without fast math and prints how far apart the two images are
+		void ReportFastMathError();
+		//Reorders the texels of every software texture
+		void SetTextureLayout(TexelImage::Layout layout);
+
 	private:
 		void CycleCurrentFilteringTechnique();
 		void CycleShadingMode();
+		void CycleCullMode();
+		void CycleDepthFormat();
+		void SetDepthFormat(Depth::Format format);
+		void CycleSampleCount();
+		void CycleTextureLayout();
+		float GetDepthCompressionRatio() const; //Of the last frame, over the tiles something got drawn in
 
 		SDL_Window* m_pWindow{};
 
@@ -69,8 +106,16 @@ namespace dae
 		ID3D11Texture2D* m_pRenderTargetBuffer{};
 		ID3D11RenderTargetView* m_pRenderTargetView{};
 
+		//Long-lived objects all come from pools sized for exactly what the renderer loads
+		ObjectPool<Mesh> m_MeshPool{ 2 };
+		ObjectPool<Texture> m_TexturePool{ 10 };
+		ObjectPool<EffectPosTex> m_PosTexEffectPool{ 1 };
+		ObjectPool<EffectTransparent> m_TransparentEffectPool{ 1 };
+
 		Mesh* m_pVehicleMesh{};
 		Mesh* m_pFireMesh{};
+		EffectPosTex* m_pVehicleEffect{};
+		EffectTransparent* m_pFireEffect{};
 		Camera* m_pCamera{};
 		Texture* m_pDiffuseTexture{};
 		Texture* m_pNormalTexture{};
@@ -85,9 +130,99 @@ namespace dae
 		//Variables
 		SDL_Surface* m_pFrontBuffer{ nullptr };
 		SDL_Surface* m_pBackBuffer{ nullptr };
-		uint32_t* m_pBackBufferPixels{};
+		uint32_t* m_pBackBufferPixels{}; //Linear, only written when a tile gets resolved
+
+		//Every software render target below is laid out tile by tile, the pixel of px, py is at m_TiledLayout.GetPixelIndex(px, py)
+		TiledLayout m_TiledLayout{};
+		uint32_t* m_pColorBuffer{};
+
+		std::byte* m_pDepthBuffer{}; //Laid out as m_DepthFormat says, read it through GetDepthBuffer
+		Depth::Format m_DepthFormat{ Depth::D32_FLOAT }; //Z
+		uint32_t* m_pVisibilityBuffer{}; //Per pixel, the index in m_Triangles of the triangle in front
+		static constexpr uint32_t NO_TRIANGLE{ UINT32_MAX };
+
+		//Binning: the screen is split in tiles, each tile is rasterized by exactly one thread
+		static constexpr int TILE_SIZE{ TiledLayout::TILE_SIZE }; //The tiles of the memory layout, a tile is contiguous in every buffer
+		static_assert(TILE_SIZE % Rasterizer::BLOCK_SIZE == 0, "Raster blocks can't straddle two tiles");
+		int m_NumTilesX{};
+		int m_NumTilesY{};
+		//Everything built per frame lives in the frame arena, which starts over at the start of binning
+		FrameArena* m_pFrameArena{};
+		ArenaVector<Rasterizer::Triangle> m_Triangles{}; //Every triangle that survived setup, in submission order
+		std::vector<ArenaVector<uint32_t>> m_TileBins{}; //Per tile, the index in m_Triangles of every triangle touching it
+
+		//Fast clear: clearing a tile only sets its flags, the clear values get written once something really needs them.
+		//Depth (and the visibility buffer) on the first triangle that isn't occluded, color when the tile gets resolved.
+		struct TileClearState
+		{
+			bool isDepthCleared{}; //Still holds the previous frame, every pixel reads as the clear value of the depth format
+			bool isColorCleared{}; //Only pixels that got drawn hold a color, the rest read as m_ClearColor
+		};
+		std::vector<TileClearState> m_TileClearStates{};
+		uint32_t m_ClearColor{};
+		uint32_t m_ClearDepthKey{};
+
+		//Perspective correct interpolation: every attribute divided by w is linear in screen space, and so is 1/w
+		struct TriangleAttributes
+		{
+			Rasterizer::PlaneEquation invW{};
+			Rasterizer::PlaneEquation uv[2]{};
+			Rasterizer::PlaneEquation normal[3]{};
+			Rasterizer::PlaneEquation tangent[3]{};
+			Rasterizer::PlaneEquation viewDirection[3]{};
+		};
+		ArenaVector<TriangleAttributes> m_TriangleAttributes{}; //Same order as m_Triangles
 
-		float* m_pDepthBufferPixels{};
+		Vector2 m_GuardBand{}; //Clipping only happens past this, in NDC
+
+		ThreadPool* m_pThreadPool{};
+		static constexpr size_t VERTICES_PER_JOB{ 2048 }; //Vertex stage jobs, a multiple of every SIMD batch size
+		Rasterizer::Kernel m_RasterKernel{ Rasterizer::SCALAR };
+		bool m_UseHierarchicalRaster{ true };
+		HiZBuffer* m_pHiZBuffer{};
+		CompressedDepth* m_pCompressedDepth{}; //Every block stays raw while compression is off
+		bool m_UseDepthCompression{ false }; //C
+		bool m_UseZPrepass{ false }; //P
+		//Multisampling shades forward, without depth compression, Z-prepass or visibility buffer
+		int m_SampleCount{ 1 }; //M
+		//Per depth block, while set the colors of its samples all match and only the first sample plane holds them.
+		//Depth is never compressed like this: the samples of a pixel sit at different spots of the triangle's depth plane.
+		uint8_t* m_pIsSampleUniform{};
+		int m_NumBlocksX{};
+		bool IsDepthCompressed() const { return m_UseDepthCompression && m_SampleCount == 1; }
+		bool IsUsingVisibilityBuffer() const { return m_UseVisibilityBuffer && m_SampleCount == 1; }
+		bool m_UseHiZ{ true };
+
+		struct FrameStats
+		{
+			std::atomic<uint64_t> pixelsRasterized{}; //Pixels that passed the coverage test
+			std::atomic<uint64_t> trianglesOccluded{}; //Triangles (per tile) rejected by the hierarchical depth test
+			std::atomic<uint64_t> pixelsShaded{}; //Pixel shader invocations
+			float rasterSeconds{};
+			float vertexSeconds{}; //Vertex transformation and the viewport transform
+			uint64_t heapAllocations{}; //Only counted in debug builds, should stay 0 once every buffer has grown to fit
+			std::atomic<uint32_t> tilesUntouched{}; //Never materialized, resolved with streaming stores only
+
+			//Depth blocks of the materialized tiles by how they ended the frame, they give the compression ratio
+			std::atomic<uint32_t> depthBlocksRaw{};
+			std::atomic<uint32_t> depthBlocksCleared{};
+			std::atomic<uint32_t> depthBlocksPlane{};
+			//Multisampled blocks of the resolved tiles, the uniform ones stored one color per pixel
+			std::atomic<uint32_t> sampleBlocksUniform{};
+			std::atomic<uint32_t> sampleBlocksExpanded{};
+
+			//Which path the triangles took through the clipper, only written by the binning thread
+			uint32_t trianglesInside{};
+			uint32_t trianglesInGuardBand{}; //Crossing the screen edges, rasterized without clipping
+			uint32_t trianglesClipped{};
+			uint32_t trianglesFrustumCulled{};
+
+			//Culling stage, after clipping
+			uint32_t trianglesFaceCulled{};
+			uint32_t trianglesDegenerate{}; //No area after snapping to the fixed point grid
+			uint32_t trianglesSmallCulled{}; //Not covering a single pixel center
+		};
+		FrameStats m_FrameStats{};
 
 		float m_AspectRatio{};
 
@@ -95,20 +230,142 @@ namespace dae
 		Texture* m_pNormalMap{};
 		Texture* m_pGlossinessMap{};
 		Texture* m_pSpecularMap{};
+		TexelImage::Layout m_TextureLayout{ TexelImage::LINEAR }; //T
+
+		//Programmable draws, after the opaque pass: depth tested against it without writing depth, and blended over it.
+		//The vectors keep their capacity from frame to frame.
+		Texture* m_pFireTexture{};
+		FireShader m_FireShader{};
+		std::vector<ShadedVertex<FireShader::Varyings>> m_FireVertices{};
+		std::vector<ShadedTriangle<FireShader::Varyings>> m_FireTriangles{};
 
 		//Functions
 		void InitializeSoftware();
-		void VertexTransformationFunction(Mesh& mesh) const;
-		void RenderTriangle(const Mesh& mesh, const std::vector<Vector2>& verteciesRaster,
-			int vertexIndex, bool swapVertex) const;
+		void VertexTransformationFunction(Mesh& mesh);
+		void TransformVerticesScalar(Mesh& mesh, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const;
+		//4 vertices at a time, returns where the scalar path has to take over for the last few
+		size_t TransformVerticesSSE2(Mesh& mesh, const Matrix& worldViewProjectionMatrix, size_t firstVertex, size_t lastVertex) const;
+		Vector4 ToScreenPosition(const Vector4& clipPosition) const;
+		float GetDepthNumerator(float clipZ) const;
+		void BinTriangles(Mesh& mesh);
+		//Starts the vector over in the frame arena, with room for as many elements as it had last frame
+		template<typename T>
+		void ResetArenaVector(ArenaVector<T>& vector) const;
+		void BinTriangle(const Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2);
+		//Clipped triangles get binned straight away, new vertices are added to the mesh's output vertices
+		void ClipTriangle(Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2);
+		uint32_t AddClippedVertex(Mesh& mesh, uint32_t insideIndex, uint32_t outsideIndex, float factor);
+		void RenderTile(int tileIndex);
+		template<Rasterizer::Pass pass>
+		void DrawTileTriangles(int tileIndex, const Rasterizer::PixelBounds& tileBounds, Rasterizer::RasterCounts& counts, int& occludedTriangles);
+		Rasterizer::PixelBounds GetTileBounds(int tileIndex) const;
+		void MaterializeDepth(int tileIndex, const Rasterizer::PixelBounds& tileBounds);
+		void MaterializeColor(int tileIndex);
+		//Where the tile starts in the tiled buffers, the tiles are numbered the same in the layout
+		int GetTileStart(int tileIndex) const { return tileIndex * TiledLayout::TILE_PIXELS; }
+		//Copies the tile to the linear back buffer, with the clear color in every pixel nothing got drawn in
+		void ResolveTile(int tileIndex);
+		void ResolveSamples(const Rasterizer::PixelBounds& tileBounds);
+		//Why setup turned a triangle down, the caller decides which stats that counts towards
+		enum SetupResult
+		{
+			SETUP_DONE,
+			SETUP_DEGENERATE,
+			SETUP_FACE_CULLED,
+			SETUP_TOO_SMALL
+		};
+		SetupResult SetupTriangle(const Mesh& mesh, uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2, Rasterizer::Triangle& triangle) const;
+		SetupResult SetupTriangle(Vector4 screenPosition0, Vector4 screenPosition1, Vector4 screenPosition2, Mesh::CullMode cullMode,
+			uint32_t vertexIndex0, uint32_t vertexIndex1, uint32_t vertexIndex2, Rasterizer::Triangle& triangle) const;
+		//Runs the shader's vertex stage over the mesh and sets up the triangles it can draw, clipped vertices get added after the mesh's own
+		template<typename Shader>
+		void SetupShadedMesh(const Mesh& mesh, const Shader& shader, std::vector<ShadedVertex<typename Shader::Varyings>>& vertices,
+			std::vector<ShadedTriangle<typename Shader::Varyings>>& triangles);
+		//Blends the triangles over the resolved tile, with the shader's pixel stage inlined into the raster loop
+		template<typename Shader>
+		void DrawShadedTile(int tileIndex, const Shader& shader, const std::vector<ShadedTriangle<typename Shader::Varyings>>& triangles);
+		TriangleAttributes SetupAttributes(const Mesh& mesh, const Rasterizer::Triangle& triangle) const;
+		bool IsOccluded(const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		//The raster kernels return how many pixels they covered
+		template<Rasterizer::Pass pass>
+		Rasterizer::RasterCounts RenderTriangle(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		//One version of every kernel per depth format and pass, the format only changes how depth keys are loaded and stored.
+		//The depth pass versions are the depth only rasterizer: no attributes, no shading, no visibility buffer.
+		template<typename DepthTraits, Rasterizer::Pass pass>
+		Rasterizer::RasterCounts RasterizeScalar(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		template<typename DepthTraits, Rasterizer::Pass pass>
+		Rasterizer::RasterCounts RasterizeSSE2(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		template<typename DepthTraits, Rasterizer::Pass pass>
+		Rasterizer::RasterCounts RasterizeAVX2(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		//Tests every sample against the triangle but shades once per pixel
+		template<typename DepthTraits, int sampleCount>
+		Rasterizer::RasterCounts RasterizeMultisampled(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds) const;
+		//Copies the first color sample of every pixel of a uniform block to the other sample planes, depth is always per sample
+		void ExpandSamples(int blockX, int blockY) const;
+		//The sample planes follow each other, each one laid out like a single sampled buffer
+		template<typename DepthTraits>
+		typename DepthTraits::Storage* GetDepthBuffer(int sample = 0) const { return reinterpret_cast<typename DepthTraits::Storage*>(m_pDepthBuffer) + sample * m_TiledLayout.GetNumPixels(); }
+		float GetStoredDepth(int px, int py) const;
+		template<typename DepthTraits>
+		uint32_t GetStoredKey(int px, int py) const;
+		//Draws a block the triangle covers completely by storing its depth plane, when it's in front of the whole block
+		template<typename DepthTraits, Rasterizer::Pass pass>
+		bool DrawDepthPlane(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& block, Rasterizer::RasterCounts& counts) const;
+		template<typename DepthTraits>
+		void ShadeDepthPlane(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& block, const CompressedDepth::Block& plane, Rasterizer::RasterCounts& counts) const;
+		//Calls rasterizeBlock for the blocks of the triangle, or for all of its bounds without the hierarchical raster
+		template<typename DepthTraits, Rasterizer::Pass pass, typename RasterizeBlock>
+		Rasterizer::RasterCounts WalkTriangle(uint32_t triangleIndex, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& bounds, RasterizeBlock&& rasterizeBlock) const;
+		int ShadeVisibleTile(const Rasterizer::PixelBounds& tileBounds) const;
+		void ShadeFragment(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const;
+		//Runs the pixel shader permutation of this frame
+		uint32_t GetFragmentColor(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const;
+		//Every permutation only interpolates, fetches and computes what its output needs, none of them branch on the settings per pixel
+		template<RenderingMode renderMode, ShadingMode shadingMode, bool useNormalMap>
+		uint32_t ShadePixel(const Rasterizer::Triangle& triangle, const TriangleAttributes& attributes, int px, int py, float interpolatedDepth) const;
+		template<ShadingMode shadingMode, bool useNormalMap>
 		ColorRGB PixelShading(const Vertex_Out& vertex) const;
+		using PixelShader = uint32_t(Renderer::*)(const Rasterizer::Triangle&, const TriangleAttributes&, int, int, float) const;
+		//Looks the permutation for the current settings up in the dispatch table
+		PixelShader SelectPixelShader() const;
+		PixelShader m_PixelShader{}; //Picked once per frame, the settings only change in between frames
+
+		//Fragments on their way to the pixel shader in SoA form, the lanes don't have to share a triangle.
+		//The AVX2 kernel and the visibility buffer fill these, the other kernels shade one fragment at a time.
+		struct FragmentBatch
+		{
+			static constexpr int SIZE{ 8 };
+			int numFragments{};
+			uint32_t triangleIndices[SIZE]{};
+			int px[SIZE]{};
+			int py[SIZE]{};
+			float depths[SIZE]{};
+		};
+		//Shades the batch once this fills it up
+		void AddFragment(FragmentBatch& batch, uint32_t triangleIndex, int px, int py, float depth) const;
+		void FlushFragments(FragmentBatch& batch) const;
+		//One fragment at a time through m_PixelShader, for every permutation the wide kernel doesn't cover
+		void ShadeBatchScalar(const FragmentBatch& batch) const;
+		//Lambert + Phong in 8 AVX2 lanes, the combined shading mode of the texture render mode.
+		//Fast math normalizes with rsqrt and one Newton step, and looks the specular power up in m_SpecularTable.
+		template<bool useNormalMap, bool useFastMath>
+		void ShadeBatchWide(const FragmentBatch& batch) const;
+		using BatchShader = void(Renderer::*)(const FragmentBatch&) const;
+		BatchShader SelectBatchShader() const;
+		BatchShader m_BatchShader{};
+		bool m_UseWideShading{ true }; //B
+		bool m_UseFastMath{ false }; //F, only the wide kernel has it
+		static constexpr float SHININESS{ 25.f }; //Of the Phong term, the glossiness map is scaled by this
+		const SpecularTable m_SpecularTable{ SHININESS };
+		float ToVisualizedDepth(float depth) const;
 
 		//Settings & Toggles
 		bool m_IsUsingDX{ true }; //F1
 		bool m_DoesRotate{ true }; //F2
-		bool m_IsUsingFireFX{ true }; //F3
+		bool m_IsUsingFireFX{ true }; //F3, both paths
 		bool m_UseNormalMap{ true }; //F6
 		bool m_UseUniformBackground{ false }; //F10
+		bool m_UseVisibilityBuffer{ false }; //V
 
 		ShadingMode m_CurrentShadingMode{ShadingMode::COMBINED};
 		RenderingMode m_CurrentRenderMode{ RenderingMode::TEXTURE };
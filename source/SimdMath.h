@@ -0,0 +1,60 @@
+#pragma once
+#include <immintrin.h>
+
+namespace dae
+{
+	//Math the 8 wide kernels need that AVX2 has no instruction for. No FMA, the AVX2 kernel doesn't require the CPU to have it.
+	//The polynomials are the Cephes single precision ones, within a few ulp of the C library over the range the shading uses.
+	namespace SimdMath
+	{
+		inline __m256 Log2(__m256 x)
+		{
+			//x = mantissa * 2^exponent, with the mantissa moved to [sqrt(0.5), sqrt(2)) so the polynomial stays near 1
+			const __m256i bits{ _mm256_castps_si256(x) };
+			__m256 exponent{ _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127))) };
+			__m256 mantissa{ _mm256_or_ps(_mm256_castsi256_ps(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF))), _mm256_set1_ps(1.f)) };
+
+			const __m256 isAboveSqrt2{ _mm256_cmp_ps(mantissa, _mm256_set1_ps(1.41421356f), _CMP_GE_OQ) };
+			mantissa = _mm256_blendv_ps(mantissa, _mm256_mul_ps(mantissa, _mm256_set1_ps(0.5f)), isAboveSqrt2);
+			exponent = _mm256_add_ps(exponent, _mm256_and_ps(isAboveSqrt2, _mm256_set1_ps(1.f)));
+
+			const __m256 t{ _mm256_sub_ps(mantissa, _mm256_set1_ps(1.f)) };
+			__m256 polynomial{ _mm256_set1_ps(7.0376836292e-2f) };
+			for (const float coefficient : { -1.1514610310e-1f, 1.1676998740e-1f, -1.2420140846e-1f, 1.4249322787e-1f,
+				-1.6668057665e-1f, 2.0000714765e-1f, -2.4999993993e-1f, 3.3333331174e-1f })
+				polynomial = _mm256_add_ps(_mm256_mul_ps(polynomial, t), _mm256_set1_ps(coefficient));
+
+			//ln(1 + t) = t - t^2 / 2 + t^3 * polynomial
+			const __m256 t2{ _mm256_mul_ps(t, t) };
+			const __m256 naturalLog{ _mm256_add_ps(_mm256_sub_ps(t, _mm256_mul_ps(t2, _mm256_set1_ps(0.5f))), _mm256_mul_ps(_mm256_mul_ps(t2, t), polynomial)) };
+			return _mm256_add_ps(_mm256_mul_ps(naturalLog, _mm256_set1_ps(1.44269504f)), exponent);
+		}
+
+		inline __m256 Exp2(__m256 x)
+		{
+			//Below 2^-126 the result would be a denormal, the shading only ever needs it as good as 0
+			x = _mm256_max_ps(_mm256_min_ps(x, _mm256_set1_ps(127.f)), _mm256_set1_ps(-126.f));
+
+			//2^x = 2^whole * 2^fraction, with the fraction in [-0.5, 0.5]
+			const __m256 whole{ _mm256_round_ps(x, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC) };
+			const __m256 fraction{ _mm256_sub_ps(x, whole) };
+
+			__m256 polynomial{ _mm256_set1_ps(1.535336188319500e-4f) };
+			for (const float coefficient : { 1.339887440266574e-3f, 9.618437357674640e-3f, 5.550332471162809e-2f, 2.402264791363012e-1f, 6.931472028550421e-1f })
+				polynomial = _mm256_add_ps(_mm256_mul_ps(polynomial, fraction), _mm256_set1_ps(coefficient));
+			polynomial = _mm256_add_ps(_mm256_mul_ps(polynomial, fraction), _mm256_set1_ps(1.f));
+
+			const __m256i scale{ _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(whole), _mm256_set1_epi32(127)), 23) };
+			return _mm256_mul_ps(polynomial, _mm256_castsi256_ps(scale));
+		}
+
+		//For a base in [0, 1], like a clamped cosine. A base of 0 gives 1 for an exponent of 0 and 0 for anything above, like powf.
+		inline __m256 Pow(__m256 base, __m256 exponent)
+		{
+			//The clamp keeps Log2 finite, but the smallest float to a small exponent is far from 0, so those lanes get masked
+			const __m256 power{ Exp2(_mm256_mul_ps(exponent, Log2(_mm256_max_ps(base, _mm256_set1_ps(1.17549435e-38f))))) };
+			const __m256 isZeroToPositive{ _mm256_and_ps(_mm256_cmp_ps(base, _mm256_setzero_ps(), _CMP_LE_OQ), _mm256_cmp_ps(exponent, _mm256_setzero_ps(), _CMP_GT_OQ)) };
+			return _mm256_andnot_ps(isZeroToPositive, power);
+		}
+	}
+}
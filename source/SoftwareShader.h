@@ -0,0 +1,80 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <type_traits>
+
+#include "Rasterizer.h"
+
+namespace dae
+{
+	//Programmable stages of the software path, what an Effect is to the hardware path.
+	//A shader is a plain struct the draw gets compiled for, the same way the kernels get compiled for a depth format:
+	//	struct Varyings: everything the pixel shader reads, floats only. The rasterizer interpolates exactly these, perspective correct.
+	//	Vector4 VertexShader(const Vertex& vertex, Varyings& varyings) const: returns the clip position
+	//	PixelOutput PixelShader(const Varyings& varyings) const
+	//Both calls are direct, so the bodies get inlined into the vertex loop and the raster loop.
+	struct PixelOutput
+	{
+		ColorRGB color{};
+		float alpha{ 1.f };
+	};
+
+	//Varyings as the array of floats the rasterizer interpolates
+	template<typename Varyings>
+	struct VaryingLayout
+	{
+		static_assert(std::is_trivially_copyable_v<Varyings> && sizeof(Varyings) % sizeof(float) == 0, "Varyings can only hold floats");
+		static constexpr int NUM_FLOATS{ sizeof(Varyings) / sizeof(float) };
+		using Floats = std::array<float, NUM_FLOATS>;
+
+		static Floats ToFloats(const Varyings& varyings) { return std::bit_cast<Floats>(varyings); }
+		static Varyings FromFloats(const Floats& floats) { return std::bit_cast<Varyings>(floats); }
+	};
+
+	//Output of the programmable vertex stage
+	template<typename Varyings>
+	struct ShadedVertex
+	{
+		Vector4 clipPosition{};
+		Vector4 screenPosition{};
+		uint16_t clipCode{};
+		Varyings varyings{};
+	};
+
+	//A triangle set up for a shader, with a plane for every float of its varyings and nothing else
+	template<typename Varyings>
+	struct ShadedTriangle
+	{
+		using Layout = VaryingLayout<Varyings>;
+
+		Rasterizer::Triangle triangle{};
+		Rasterizer::PlaneEquation invW{};
+		Rasterizer::PlaneEquation varyings[Layout::NUM_FLOATS]{}; //Divided by w
+
+		void SetupVaryings(const ShadedVertex<Varyings>& vertex0, const ShadedVertex<Varyings>& vertex1, const ShadedVertex<Varyings>& vertex2)
+		{
+			const float invW0{ 1.f / vertex0.screenPosition.w };
+			const float invW1{ 1.f / vertex1.screenPosition.w };
+			const float invW2{ 1.f / vertex2.screenPosition.w };
+			invW = triangle.SetupPlane(invW0, invW1, invW2);
+
+			const typename Layout::Floats floats0{ Layout::ToFloats(vertex0.varyings) };
+			const typename Layout::Floats floats1{ Layout::ToFloats(vertex1.varyings) };
+			const typename Layout::Floats floats2{ Layout::ToFloats(vertex2.varyings) };
+			for (int i{ 0 }; i < Layout::NUM_FLOATS; ++i)
+				varyings[i] = triangle.SetupPlane(floats0[i] * invW0, floats1[i] * invW1, floats2[i] * invW2);
+		}
+
+		Varyings Interpolate(int px, int py) const
+		{
+			const int offsetX{ px - triangle.bounds.min.x };
+			const int offsetY{ py - triangle.bounds.min.y };
+			const float w{ 1.f / invW.Evaluate(offsetX, offsetY) };
+
+			typename Layout::Floats floats{};
+			for (int i{ 0 }; i < Layout::NUM_FLOATS; ++i)
+				floats[i] = varyings[i].Evaluate(offsetX, offsetY) * w;
+			return Layout::FromFloats(floats);
+		}
+	};
+}
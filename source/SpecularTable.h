@@ -0,0 +1,47 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <vector>
+
+namespace dae
+{
+	//powf(alfa, glossiness) of the Phong term, precomputed for the fast math shading.
+	//The glossiness is an 8 bit texel times the shininess, so a row per texel value covers every exponent exactly.
+	//Alfa is quantized to ALFA_STEPS steps over [0, 1] and linearly interpolated in between, which keeps the error below 1/255 up to
+	//an exponent of 25. Alfa above 1 gets clamped to 1, the caller has to handle those lanes if it can have them.
+	class SpecularTable final
+	{
+	public:
+		static constexpr int ALFA_STEPS{ 128 };
+		static constexpr int ROW_SIZE{ ALFA_STEPS + 1 }; //The last step needs the entry after it to interpolate towards
+		static constexpr int NUM_GLOSSINESS_VALUES{ 256 };
+
+		explicit SpecularTable(float shininess) :
+			m_Values(NUM_GLOSSINESS_VALUES * ROW_SIZE)
+		{
+			for (int glossiness{ 0 }; glossiness < NUM_GLOSSINESS_VALUES; ++glossiness)
+			{
+				const float exponent{ glossiness / 255.f * shininess };
+				for (int step{ 0 }; step < ROW_SIZE; ++step)
+					m_Values[glossiness * ROW_SIZE + step] = powf(static_cast<float>(step) / ALFA_STEPS, exponent);
+			}
+		}
+
+		//Glossiness as the texel value from 0 to 255. Alfa below 0 comes out as 0 to the power, the caller masks those lanes.
+		__m256 Lookup8(__m256 alfa, __m256i glossiness) const
+		{
+			const __m256 position{ _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(alfa, _mm256_setzero_ps()), _mm256_set1_ps(1.f)), _mm256_set1_ps(static_cast<float>(ALFA_STEPS))) };
+			const __m256i step{ _mm256_min_epi32(_mm256_cvttps_epi32(position), _mm256_set1_epi32(ALFA_STEPS - 1)) };
+			const __m256 fraction{ _mm256_sub_ps(position, _mm256_cvtepi32_ps(step)) };
+
+			const __m256i index{ _mm256_add_epi32(_mm256_mullo_epi32(glossiness, _mm256_set1_epi32(ROW_SIZE)), step) };
+			const __m256 below{ _mm256_i32gather_ps(m_Values.data(), index, 4) };
+			const __m256 above{ _mm256_i32gather_ps(m_Values.data() + 1, index, 4) };
+			return _mm256_add_ps(below, _mm256_mul_ps(_mm256_sub_ps(above, below), fraction));
+		}
+
+	private:
+		std::vector<float> m_Values{};
+	};
+}
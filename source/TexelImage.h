@@ -0,0 +1,157 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <immintrin.h>
+#include <new>
+
+namespace dae
+{
+	//The software copy of a texture, converted once at load time so a fetch is index math and a load, no SDL format lookups.
+	//Every texel is RGBA8 with red in the lowest byte, whatever format the file had. The memory is aligned to a cache line.
+	//	LINEAR: row after row, every row padded to a whole number of cache lines
+	//	MORTON: 32x32 texel tiles (4 KB, one page) one after the other, the texels inside of a tile in Morton order.
+	//	        Neighbours in v are as close in memory as neighbours in u, which is what a turned or minified triangle needs.
+	class TexelImage final
+	{
+	public:
+		enum Layout
+		{
+			LINEAR,
+			MORTON,
+			NUM_LAYOUTS
+		};
+		static const char* GetLayoutName(Layout layout)
+		{
+			switch (layout)
+			{
+			case LINEAR: return "LINEAR";
+			case MORTON: return "MORTON";
+			default: return "UNKNOWN";
+			}
+		}
+
+		//pPixels are RGBA8 rows pitch bytes apart, the way a surface converted to SDL_PIXELFORMAT_RGBA32 holds them
+		TexelImage(const void* pPixels, int width, int height, int pitch, Layout layout) :
+			m_Width{ width },
+			m_Height{ height },
+			m_Layout{ layout },
+			m_Pitch{ (width * static_cast<int>(sizeof(uint32_t)) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE / static_cast<int>(sizeof(uint32_t)) },
+			m_NumTilesX{ (width + TILE_SIZE - 1) / TILE_SIZE },
+			m_NumTilesY{ (height + TILE_SIZE - 1) / TILE_SIZE }
+		{
+			m_pTexels = Allocate(m_Layout);
+			for (int y{ 0 }; y < m_Height; ++y)
+			{
+				const uint32_t* const pRow{ reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(pPixels) + y * pitch) };
+				for (int x{ 0 }; x < m_Width; ++x)
+					m_pTexels[GetTexelIndex(x, y, m_Layout)] = pRow[x];
+			}
+		}
+
+		~TexelImage()
+		{
+			Free(m_pTexels);
+		}
+
+		TexelImage(const TexelImage&) = delete;
+		TexelImage(TexelImage&&) noexcept = delete;
+		TexelImage& operator=(const TexelImage&) = delete;
+		TexelImage& operator=(TexelImage&&) noexcept = delete;
+
+		//Reorders the texels, allocates
+		void SetLayout(Layout layout)
+		{
+			if (layout == m_Layout)
+				return;
+
+			uint32_t* const pTexels{ Allocate(layout) };
+			for (int y{ 0 }; y < m_Height; ++y)
+			{
+				for (int x{ 0 }; x < m_Width; ++x)
+					pTexels[GetTexelIndex(x, y, layout)] = m_pTexels[GetTexelIndex(x, y, m_Layout)];
+			}
+
+			Free(m_pTexels);
+			m_pTexels = pTexels;
+			m_Layout = layout;
+		}
+		Layout GetLayout() const { return m_Layout; }
+
+		int GetWidth() const { return m_Width; }
+		int GetHeight() const { return m_Height; }
+
+		uint32_t GetTexel(int x, int y) const
+		{
+			return m_pTexels[GetTexelIndex(x, y, m_Layout)];
+		}
+
+		//8 texels at once, x and y have to be inside of the image
+		__m256i GatherTexels(__m256i x, __m256i y) const
+		{
+			__m256i index{};
+			if (m_Layout == LINEAR)
+				index = _mm256_add_epi32(x, _mm256_mullo_epi32(y, _mm256_set1_epi32(m_Pitch)));
+			else
+			{
+				const __m256i tileMask{ _mm256_set1_epi32(TILE_SIZE - 1) };
+				const __m256i tileIndex{ _mm256_add_epi32(_mm256_srli_epi32(x, TILE_SHIFT),
+					_mm256_mullo_epi32(_mm256_srli_epi32(y, TILE_SHIFT), _mm256_set1_epi32(m_NumTilesX))) };
+				const __m256i inTile{ _mm256_or_si256(SpreadBits(_mm256_and_si256(x, tileMask)), _mm256_slli_epi32(SpreadBits(_mm256_and_si256(y, tileMask)), 1)) };
+				index = _mm256_or_si256(_mm256_slli_epi32(tileIndex, 2 * TILE_SHIFT), inTile);
+			}
+			return _mm256_i32gather_epi32(reinterpret_cast<const int*>(m_pTexels), index, 4);
+		}
+
+	private:
+		static constexpr int TILE_SHIFT{ 5 };
+		static constexpr int TILE_SIZE{ 1 << TILE_SHIFT };
+		static constexpr int CACHE_LINE_SIZE{ 64 };
+
+		uint32_t* m_pTexels{};
+		int m_Width{};
+		int m_Height{};
+		Layout m_Layout{ LINEAR };
+		int m_Pitch{}; //In texels, for LINEAR
+		int m_NumTilesX{}; //For MORTON
+		int m_NumTilesY{};
+
+		//Puts a zero bit in front of each of the TILE_SHIFT bits, the other coordinate goes in between
+		static uint32_t SpreadBits(uint32_t value)
+		{
+			value = (value | (value << 4)) & 0x0F0F0F0F;
+			value = (value | (value << 2)) & 0x33333333;
+			return (value | (value << 1)) & 0x55555555;
+		}
+		static __m256i SpreadBits(__m256i value)
+		{
+			value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 4)), _mm256_set1_epi32(0x0F0F0F0F));
+			value = _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 2)), _mm256_set1_epi32(0x33333333));
+			return _mm256_and_si256(_mm256_or_si256(value, _mm256_slli_epi32(value, 1)), _mm256_set1_epi32(0x55555555));
+		}
+
+		int GetTexelIndex(int x, int y, Layout layout) const
+		{
+			if (layout == LINEAR)
+				return y * m_Pitch + x;
+
+			const int tileIndex{ (y >> TILE_SHIFT) * m_NumTilesX + (x >> TILE_SHIFT) };
+			return (tileIndex << (2 * TILE_SHIFT)) | static_cast<int>(SpreadBits(x & (TILE_SIZE - 1)) | (SpreadBits(y & (TILE_SIZE - 1)) << 1));
+		}
+
+		//Room for the texels in a layout, padding included. Leaves m_pTexels alone.
+		uint32_t* Allocate(Layout layout) const
+		{
+			//The padding is never sampled, zeroed so the image is the same every run
+			const size_t numTexels{ layout == LINEAR ? static_cast<size_t>(m_Pitch) * m_Height
+				: static_cast<size_t>(m_NumTilesX) * m_NumTilesY * TILE_SIZE * TILE_SIZE };
+			uint32_t* const pTexels{ static_cast<uint32_t*>(::operator new(numTexels * sizeof(uint32_t), std::align_val_t{ CACHE_LINE_SIZE })) };
+			std::fill_n(pTexels, numTexels, 0u);
+			return pTexels;
+		}
+
+		static void Free(uint32_t* pTexels)
+		{
+			::operator delete(pTexels, std::align_val_t{ CACHE_LINE_SIZE });
+		}
+	};
+}
@@ -40,26 +40,29 @@ namespace dae
 
 		SDL_FreeSurface(pSurface);
 	}
-	Texture::Texture(SDL_Surface* pSurface) :
-		m_pSurface{ pSurface },
-		m_pSurfacePixels{ (uint32_t*)pSurface->pixels }
+	Texture::Texture(SDL_Surface* pSurface, TexelImage::Layout layout)
 	{
+		//Whatever IMG_Load made of the file, SDL does the conversion to bytes in R, G, B, A order
+		SDL_Surface* const pConverted{ SDL_ConvertSurfaceFormat(pSurface, SDL_PIXELFORMAT_RGBA32, 0) };
+		SDL_LockSurface(pConverted);
+		m_pImage = new TexelImage(pConverted->pixels, pConverted->w, pConverted->h, pConverted->pitch, layout);
+		SDL_UnlockSurface(pConverted);
+
+		SDL_FreeSurface(pConverted);
+		SDL_FreeSurface(pSurface);
 	}
 
-	Texture* Texture::LoadFromFile(const std::string& path)
+	Texture* Texture::LoadFromFile(const std::string& path, ObjectPool<Texture>& pool, TexelImage::Layout layout)
 	{
-		Texture* texture = new Texture{ IMG_Load(path.c_str()) };
+		Texture* texture = pool.Create(IMG_Load(path.c_str()), layout);
 		return texture;
 	}
 	Texture::~Texture()
 	{
 		if (m_pResource) m_pResource->Release();
 		if (m_pShaderResourceView) m_pShaderResourceView->Release();
-		if (m_pSurface)
-		{
-			SDL_FreeSurface(m_pSurface);
-			m_pSurface = nullptr;
-		}
+		delete m_pImage;
+		m_pImage = nullptr;
 
 	}
 	ID3D11Texture2D* Texture::GetResource() const
@@ -73,17 +76,46 @@ namespace dae
 
 	ColorRGB Texture::Sample(const Vector2& uv) const
 	{
-		unsigned char r{}, g{}, b{};
+		const int x{ std::min(int(uv.x * m_pImage->GetWidth()), m_pImage->GetWidth() - 1) };
+		const int y{ std::min(int(uv.y * m_pImage->GetHeight()), m_pImage->GetHeight() - 1) };
+
+		const uint32_t texel{ m_pImage->GetTexel(x, y) };
+
+		constexpr float inverseClampedValue{ 1 / 255.f };
+
+		return { (texel & 0xFF) * inverseClampedValue, ((texel >> 8) & 0xFF) * inverseClampedValue, ((texel >> 16) & 0xFF) * inverseClampedValue };
+	}
+
+	void Texture::Sample8(__m256 u, __m256 v, __m256& r, __m256& g, __m256& b) const
+	{
+		const int width{ m_pImage->GetWidth() };
+		const int height{ m_pImage->GetHeight() };
+		const __m256i x{ _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(u, _mm256_set1_ps(static_cast<float>(width)))), _mm256_set1_epi32(width - 1)) };
+		const __m256i y{ _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_mul_ps(v, _mm256_set1_ps(static_cast<float>(height)))), _mm256_set1_epi32(height - 1)) };
+		const __m256i texels{ m_pImage->GatherTexels(x, y) };
 
-		const int x{ std::min(int(uv.x * m_pSurface->w), m_pSurface->w - 1) };
-		const int y{ std::min(int(uv.y * m_pSurface->h), m_pSurface->h - 1) };
+		const __m256 inverseClampedValue{ _mm256_set1_ps(1 / 255.f) };
+		const __m256i channelMask{ _mm256_set1_epi32(0xFF) };
+		r = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(texels, channelMask)), inverseClampedValue);
+		g = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 8), channelMask)), inverseClampedValue);
+		b = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(texels, 16), channelMask)), inverseClampedValue);
+	}
 
-		unsigned const int pixel{ m_pSurfacePixels[x + y * m_pSurface->w] };
+	void Texture::SetLayout(TexelImage::Layout layout)
+	{
+		m_pImage->SetLayout(layout);
+	}
+
+	ColorRGB Texture::Sample(const Vector2& uv, float& alpha) const
+	{
+		const int x{ std::min(int(uv.x * m_pImage->GetWidth()), m_pImage->GetWidth() - 1) };
+		const int y{ std::min(int(uv.y * m_pImage->GetHeight()), m_pImage->GetHeight() - 1) };
 
-		SDL_GetRGB(pixel, m_pSurface->format, &r, &g, &b);
+		const uint32_t texel{ m_pImage->GetTexel(x, y) };
 
 		constexpr float inverseClampedValue{ 1 / 255.f };
 
-		return { r * inverseClampedValue, g * inverseClampedValue, b * inverseClampedValue };
+		alpha = (texel >> 24) * inverseClampedValue;
+		return { (texel & 0xFF) * inverseClampedValue, ((texel >> 8) & 0xFF) * inverseClampedValue, ((texel >> 16) & 0xFF) * inverseClampedValue };
 	}
 }
\ No newline at end of file
@@ -1,5 +1,10 @@
 #pragma once
+#include <immintrin.h>
 #include <string>
+#include "ObjectPool.h"
+#include "TexelImage.h"
+
+struct SDL_Surface;
 
 namespace dae
 {
@@ -17,13 +22,18 @@ namespace dae
 		};
 
 		Texture(const std::string& path, ID3D11Device* pDevice, TextureType textureType);
-		Texture(SDL_Surface* pSurface);
+		//Converts the surface for the software path and frees it
+		Texture(SDL_Surface* pSurface, TexelImage::Layout layout);
 		~Texture();
-		static Texture* LoadFromFile(const std::string& path);
+		static Texture* LoadFromFile(const std::string& path, ObjectPool<Texture>& pool, TexelImage::Layout layout);
 		ID3D11Texture2D* GetResource() const;
 		ID3D11ShaderResourceView* GetShaderResourceView() const;
 
 		ColorRGB Sample(const Vector2& uv) const;
+		ColorRGB Sample(const Vector2& uv, float& alpha) const;
+		//8 texels at once with an AVX2 gather, the same texels Sample picks
+		void Sample8(__m256 u, __m256 v, __m256& r, __m256& g, __m256& b) const;
+		void SetLayout(TexelImage::Layout layout);
 
 	private:
 		//DirectX
@@ -31,7 +41,6 @@ namespace dae
 		ID3D11ShaderResourceView* m_pShaderResourceView{};
 
 		//Software
-		SDL_Surface* m_pSurface{ nullptr };
-		uint32_t* m_pSurfacePixels{ nullptr };
+		TexelImage* m_pImage{ nullptr };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "ThreadPool.h"
+
+namespace dae
+{
+	ThreadPool::ThreadPool(uint32_t numThreads)
+	{
+		m_Workers.reserve(numThreads);
+		for (uint32_t i{ 0 }; i < numThreads; ++i)
+			m_Workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_IsStopping = true;
+		}
+		m_WakeCondition.notify_all();
+
+		for (auto& worker : m_Workers)
+			worker.join();
+	}
+
+	void ThreadPool::Run(uint32_t count, const void* pJob, JobFunction pJobFunction)
+	{
+		if (count == 0)
+			return;
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_pJob = pJob;
+			m_pJobFunction = pJobFunction;
+			m_JobCount = count;
+			m_NextJobIndex = 0;
+			m_BusyWorkers = GetNumThreads();
+			++m_Generation;
+		}
+		m_WakeCondition.notify_all();
+
+		RunJobs();
+
+		//Wait until every worker has left the job, only then is it safe to let it go out of scope
+		std::unique_lock lock{ m_Mutex };
+		m_DoneCondition.wait(lock, [this] { return m_BusyWorkers == 0; });
+		m_pJob = nullptr;
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		uint64_t lastGeneration{ 0 };
+		while (true)
+		{
+			{
+				std::unique_lock lock{ m_Mutex };
+				m_WakeCondition.wait(lock, [&] { return m_IsStopping || m_Generation != lastGeneration; });
+				if (m_IsStopping)
+					return;
+
+				lastGeneration = m_Generation;
+			}
+
+			RunJobs();
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				--m_BusyWorkers;
+			}
+			m_DoneCondition.notify_one();
+		}
+	}
+
+	void ThreadPool::RunJobs()
+	{
+		for (uint32_t index{ m_NextJobIndex++ }; index < m_JobCount; index = m_NextJobIndex++)
+			m_pJobFunction(m_pJob, index);
+	}
+}
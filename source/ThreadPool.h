@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dae
+{
+	class ThreadPool final
+	{
+	public:
+		//A pool with 0 threads runs every job on the calling thread
+		explicit ThreadPool(uint32_t numThreads);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool(ThreadPool&&) noexcept = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool&&) noexcept = delete;
+
+		//Runs job(index) for every index in [0, count) and blocks until all of them are done.
+		//The calling thread helps out, so jobs are picked up by GetNumThreads() + 1 threads.
+		template<typename Job>
+		void ParallelFor(uint32_t count, const Job& job)
+		{
+			//Type erased by hand, a std::function could allocate on every call
+			Run(count, &job, [](const void* pJob, uint32_t index) { (*static_cast<const Job*>(pJob))(index); });
+		}
+
+		uint32_t GetNumThreads() const { return static_cast<uint32_t>(m_Workers.size()); }
+
+	private:
+		using JobFunction = void(*)(const void* pJob, uint32_t index);
+
+		void Run(uint32_t count, const void* pJob, JobFunction pJobFunction);
+		void WorkerLoop();
+		void RunJobs();
+
+		std::vector<std::thread> m_Workers{};
+
+		std::mutex m_Mutex{};
+		std::condition_variable m_WakeCondition{};
+		std::condition_variable m_DoneCondition{};
+
+		const void* m_pJob{ nullptr };
+		JobFunction m_pJobFunction{ nullptr };
+		uint32_t m_JobCount{};
+		std::atomic<uint32_t> m_NextJobIndex{};
+
+		uint32_t m_BusyWorkers{};
+		uint64_t m_Generation{};
+		bool m_IsStopping{ false };
+	};
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+namespace dae
+{
+	//Memory layout of the software render targets: tile after tile instead of row after row.
+	//A 64x64 tile is one contiguous 16 KB at 4 bytes per pixel, four 4 KB pages and small enough to stay in L1 while a thread works on it.
+	//Inside of a tile the rows are 64 pixels (4 cache lines) apart, so the 4 and 8 wide kernels still load and store a row in one go.
+	//Tiles on the right and bottom edge are padded to full tiles, every tile starts at a multiple of the tile size.
+	struct TiledLayout
+	{
+		static constexpr int TILE_SHIFT{ 6 };
+		static constexpr int TILE_SIZE{ 1 << TILE_SHIFT };
+		static constexpr int TILE_PIXELS{ TILE_SIZE * TILE_SIZE };
+
+		int numTilesX{};
+		int numTilesY{};
+
+		TiledLayout() = default;
+		TiledLayout(int width, int height) :
+			numTilesX{ (width + TILE_SIZE - 1) / TILE_SIZE },
+			numTilesY{ (height + TILE_SIZE - 1) / TILE_SIZE }
+		{
+		}
+
+		//What a buffer needs, padding included
+		int GetNumPixels() const
+		{
+			return numTilesX * numTilesY * TILE_PIXELS;
+		}
+
+		int GetPixelIndex(int px, int py) const
+		{
+			const int tileIndex{ (py >> TILE_SHIFT) * numTilesX + (px >> TILE_SHIFT) };
+			return (tileIndex << (2 * TILE_SHIFT)) + ((py & (TILE_SIZE - 1)) << TILE_SHIFT) + (px & (TILE_SIZE - 1));
+		}
+	};
+}
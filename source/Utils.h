@@ -1,6 +1,7 @@
 #pragma once
 #include <cassert>
 #include <fstream>
+#include <unordered_map>
 #include "Math.h"
 #include "DataTypes.h"
 
@@ -10,7 +11,31 @@ namespace dae
 {
 	namespace Utils
 	{
-		//Just parses vertices and indices
+		//The position, uv and normal index of a face corner, corners with the same indices become the same vertex
+		struct OBJVertexKey
+		{
+			size_t position{};
+			size_t texCoord{};
+			size_t normal{};
+
+			bool operator==(const OBJVertexKey& other) const
+			{
+				return position == other.position && texCoord == other.texCoord && normal == other.normal;
+			}
+		};
+
+		struct OBJVertexKeyHash
+		{
+			size_t operator()(const OBJVertexKey& key) const
+			{
+				size_t hash{ std::hash<size_t>{}(key.position) };
+				hash ^= std::hash<size_t>{}(key.texCoord) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				hash ^= std::hash<size_t>{}(key.normal) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+				return hash;
+			}
+		};
+
+		//Parses vertices and indices, face corners sharing the same position, uv and normal are welded into one vertex
 #pragma warning(push)
 #pragma warning(disable : 4505) //Warning unreferenced local function
 		static bool ParseOBJ(const std::string& filename, std::vector<Vertex_PosTex>& vertices, std::vector<uint32_t>& indices, bool flipAxisAndWinding = true)
@@ -34,6 +59,8 @@ namespace dae
 			vertices.clear();
 			indices.clear();
 
+			std::unordered_map<OBJVertexKey, uint32_t, OBJVertexKeyHash> weldedVertices{};
+
 			std::string sCommand;
 			// start a while iteration ending when the end of file is reached (ios::eof)
 			while (!file.eof())
@@ -82,7 +109,9 @@ namespace dae
 					uint32_t tempIndices[3];
 					for (size_t iFace = 0; iFace < 3; iFace++)
 					{
-						// OBJ format uses 1-based arrays
+						// OBJ format uses 1-based arrays, 0 means the attribute is missing
+						iTexCoord = 0;
+						iNormal = 0;
 						file >> iPosition;
 						vertex.position = positions[iPosition - 1];
 
@@ -107,8 +136,12 @@ namespace dae
 							}
 						}
 
-						vertices.push_back(vertex);
-						tempIndices[iFace] = uint32_t(vertices.size()) - 1;
+						//Only the first corner with these indices adds a vertex, the others point to it
+						const auto [it, isNew] { weldedVertices.try_emplace({ iPosition, iTexCoord, iNormal }, uint32_t(vertices.size())) };
+						if (isNew)
+							vertices.push_back(vertex);
+
+						tempIndices[iFace] = it->second;
 					}
 
 					indices.push_back(tempIndices[0]);
@@ -145,7 +178,13 @@ namespace dae
 				const Vector3 edge1 = p2 - p0;
 				const Vector2 diffX = Vector2(uv1.x - uv0.x, uv2.x - uv0.x);
 				const Vector2 diffY = Vector2(uv1.y - uv0.y, uv2.y - uv0.y);
-				float r = 1.f / Vector2::Cross(diffX, diffY);
+				const float cross = Vector2::Cross(diffX, diffY);
+
+				//A face without uv area would spread an infinite tangent over every face sharing its vertices
+				if (cross == 0.f)
+					continue;
+
+				float r = 1.f / cross;
 
 				Vector3 tangent = (edge0 * diffY.y - edge1 * diffY.x) * r;
 				vertices[index0].tangent += tangent;
@@ -156,7 +195,10 @@ namespace dae
 			//Fix the tangents per vertex now because we accumulated
 			for (auto& v : vertices)
 			{
-				//v.tangent = Vector3::Reject(v.tangent, v.normal).Normalized();
+				//The sum of the faces around a welded vertex isn't perpendicular to its normal anymore
+				const Vector3 tangent{ Vector3::Reject(v.tangent, v.normal) };
+				if (tangent.SqrMagnitude() > 0.f)
+					v.tangent = tangent.Normalized();
 
 				if (flipAxisAndWinding)
 				{
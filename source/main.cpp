@@ -17,10 +17,6 @@ void ShutDown(SDL_Window* pWindow)
 
 int main(int argc, char* args[])
 {
-	//Unreferenced parameters
-	(void)argc;
-	(void)args;
-
 	//Create window + surfaces
 	SDL_Init(SDL_INIT_VIDEO);
 
@@ -41,6 +37,18 @@ int main(int argc, char* args[])
 	const auto pTimer = new Timer();
 	const auto pRenderer = new Renderer(pWindow);
 
+	//Measure the software rasterizer and quit: DirectX.exe --benchmark
+	if (argc > 1 && std::string{ args[1] } == "--benchmark")
+	{
+		pRenderer->RunBenchmark();
+
+		delete pRenderer;
+		delete pTimer;
+
+		ShutDown(pWindow);
+		return 0;
+	}
+
 	//Start loop
 	pTimer->Start();
 	float printTimer = 0.f;
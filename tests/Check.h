@@ -0,0 +1,46 @@
+#pragma once
+#include <cstdio>
+
+//The tests are plain executables, a failed CHECK prints where it failed and makes main return 1.
+//CHECK returns the condition, so a test can print what it was looking at when it fails.
+namespace dae
+{
+	namespace Check
+	{
+		//Only the first few failures get printed, a broken loop would bury everything else
+		constexpr int MAX_PRINTED_FAILURES{ 20 };
+
+		inline int& GetNumFailures()
+		{
+			static int numFailures{};
+			return numFailures;
+		}
+
+		//For the details a test prints next to a failed check
+		inline bool IsPrintingFailures()
+		{
+			return GetNumFailures() <= MAX_PRINTED_FAILURES;
+		}
+
+		inline bool Report(bool condition, const char* expression, const char* file, int line)
+		{
+			if (!condition && ++GetNumFailures() <= MAX_PRINTED_FAILURES)
+				std::printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+			return condition;
+		}
+
+		inline int Finish(const char* testName)
+		{
+			if (GetNumFailures() == 0)
+			{
+				std::printf("%s: passed\n", testName);
+				return 0;
+			}
+
+			std::printf("%s: %d checks failed\n", testName, GetNumFailures());
+			return 1;
+		}
+	}
+}
+
+#define CHECK(condition) dae::Check::Report(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
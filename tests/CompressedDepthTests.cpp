@@ -0,0 +1,132 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "CompressedDepth.h"
+
+using namespace dae;
+
+namespace
+{
+	//Not a whole number of tiles or blocks, so the padded tiles and the cut off blocks on the edges get tested too
+	constexpr int SCREEN_WIDTH{ 150 };
+	constexpr int SCREEN_HEIGHT{ 100 };
+	constexpr int NUM_TRIANGLES{ 500 };
+
+	//What the raster kernels store for a pixel of the triangle: the depth plane stepped along the row
+	template<typename DepthTraits>
+	uint32_t GetKernelKey(const Rasterizer::Triangle& triangle, int px, int py)
+	{
+		const float rowDepth{ triangle.depth.Evaluate(0, py - triangle.bounds.min.y) };
+		return DepthTraits::ToKey(rowDepth + triangle.depth.stepX * (px - triangle.bounds.min.x));
+	}
+
+	//Big triangles with their depths well inside of [0, 1], so every one covers whole blocks and its plane never leaves the range
+	Rasterizer::Triangle BuildTriangle(std::mt19937& random)
+	{
+		std::uniform_int_distribution<int> x{ -SCREEN_WIDTH / 2 * Rasterizer::SUBPIXEL_ONE, SCREEN_WIDTH * 3 / 2 * Rasterizer::SUBPIXEL_ONE };
+		std::uniform_int_distribution<int> y{ -SCREEN_HEIGHT / 2 * Rasterizer::SUBPIXEL_ONE, SCREEN_HEIGHT * 3 / 2 * Rasterizer::SUBPIXEL_ONE };
+		std::uniform_real_distribution<float> depth{ 0.05f, 0.95f };
+
+		Rasterizer::Triangle triangle{};
+		for (;;)
+		{
+			Int2 vertex0{ x(random), y(random) };
+			Int2 vertex1{ x(random), y(random) };
+			Int2 vertex2{ x(random), y(random) };
+			if (Rasterizer::GetDoubleArea(vertex0, vertex1, vertex2) < 0)
+				std::swap(vertex1, vertex2);
+
+			if (triangle.Setup(vertex0, vertex1, vertex2, SCREEN_WIDTH, SCREEN_HEIGHT))
+			{
+				triangle.depth = triangle.SetupPlane(depth(random), depth(random), depth(random));
+				return triangle;
+			}
+		}
+	}
+
+	template<Depth::Format format>
+	void TestFormat()
+	{
+		using DepthTraits = Depth::Traits<format>;
+		using Storage = typename DepthTraits::Storage;
+		const char* const formatName{ Depth::GetFormatName(format) };
+
+		CompressedDepth compressedDepth{ SCREEN_WIDTH, SCREEN_HEIGHT };
+		const TiledLayout layout{ SCREEN_WIDTH, SCREEN_HEIGHT };
+		const int numBlocksX{ (SCREEN_WIDTH + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE };
+		const int numBlocksY{ (SCREEN_HEIGHT + Rasterizer::BLOCK_SIZE - 1) / Rasterizer::BLOCK_SIZE };
+		const Rasterizer::PixelBounds screenBounds{ { 0, 0 }, { SCREEN_WIDTH, SCREEN_HEIGHT } };
+
+		//Untouched pixels keep this, so a block that writes outside of itself shows up
+		const Storage untouched{ DepthTraits::ToStorage(DepthTraits::ToKey(0.5f)) };
+		std::vector<Storage> depthBuffer(layout.GetNumPixels(), untouched);
+
+		std::mt19937 random{ 17 };
+		for (int triangleIndex{ 0 }; triangleIndex < NUM_TRIANGLES; ++triangleIndex)
+		{
+			const Rasterizer::Triangle triangle{ BuildTriangle(random) };
+			std::fill(depthBuffer.begin(), depthBuffer.end(), untouched);
+			compressedDepth.SetState(screenBounds, CompressedDepth::RAW);
+
+			//Every block the triangle covers completely keeps the plane, the way the kernels compress
+			for (int blockY{ 0 }; blockY < numBlocksY; ++blockY)
+			{
+				for (int blockX{ 0 }; blockX < numBlocksX; ++blockX)
+				{
+					const Rasterizer::PixelBounds blockBounds{ compressedDepth.GetBlockBounds(blockX, blockY) };
+					if (triangle.TestBlock(blockBounds) != Rasterizer::INSIDE)
+						continue;
+
+					compressedDepth.SetPlane(blockX, blockY, triangle, triangleIndex);
+					CHECK(compressedDepth.GetBlock(blockX, blockY).IsPlaneOf(triangleIndex));
+					CHECK(!compressedDepth.GetBlock(blockX, blockY).IsPlaneOf(triangleIndex + 1));
+
+					//The farthest key is in a corner, GetMaxKey has to find exactly the farthest pixel of the block
+					uint32_t maxKey{};
+					for (int py{ blockBounds.min.y }; py < blockBounds.max.y; ++py)
+						for (int px{ blockBounds.min.x }; px < blockBounds.max.x; ++px)
+							maxKey = std::max(maxKey, GetKernelKey<DepthTraits>(triangle, px, py));
+					CHECK(compressedDepth.GetMaxKey<DepthTraits>(blockX, blockY) == maxKey);
+				}
+			}
+
+			compressedDepth.Decompress<DepthTraits>(screenBounds, depthBuffer.data());
+
+			for (int py{ 0 }; py < SCREEN_HEIGHT; ++py)
+			{
+				for (int px{ 0 }; px < SCREEN_WIDTH; ++px)
+				{
+					const int blockX{ px / Rasterizer::BLOCK_SIZE };
+					const int blockY{ py / Rasterizer::BLOCK_SIZE };
+					const bool isCompressed{ triangle.TestBlock(compressedDepth.GetBlockBounds(blockX, blockY)) == Rasterizer::INSIDE };
+					const uint32_t storedKey{ DepthTraits::FromStorage(depthBuffer[layout.GetPixelIndex(px, py)]) };
+					const uint32_t expectedKey{ isCompressed ? GetKernelKey<DepthTraits>(triangle, px, py) : DepthTraits::FromStorage(untouched) };
+
+					//Bit for bit what the kernel would have stored, the compressed blocks are the same as drawing the triangle
+					if (!CHECK(storedKey == expectedKey) && Check::IsPrintingFailures())
+						std::printf("  %s, triangle %d, pixel (%d, %d): key 0x%08x instead of 0x%08x\n", formatName, triangleIndex, px, py, storedKey, expectedKey);
+					CHECK(compressedDepth.GetBlock(blockX, blockY).state == CompressedDepth::RAW);
+				}
+			}
+		}
+
+		//A cleared block decompresses to the clear value, and that is also the farthest it can be
+		std::fill(depthBuffer.begin(), depthBuffer.end(), untouched);
+		compressedDepth.SetState(screenBounds, CompressedDepth::CLEARED);
+		CHECK(compressedDepth.GetMaxKey<DepthTraits>(numBlocksX - 1, numBlocksY - 1) == Depth::GetClearKey(format));
+		compressedDepth.Decompress<DepthTraits>(screenBounds, depthBuffer.data());
+		for (int py{ 0 }; py < SCREEN_HEIGHT; ++py)
+			for (int px{ 0 }; px < SCREEN_WIDTH; ++px)
+				CHECK(DepthTraits::FromStorage(depthBuffer[layout.GetPixelIndex(px, py)]) == Depth::GetClearKey(format));
+	}
+}
+
+int main()
+{
+	TestFormat<Depth::D32_FLOAT>();
+	TestFormat<Depth::D24_UNORM>();
+	TestFormat<Depth::D16_UNORM>();
+	TestFormat<Depth::D32_FLOAT_REVERSED>();
+	return Check::Finish("CompressedDepthTests");
+}
@@ -0,0 +1,134 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "DepthFormat.h"
+#include "Rasterizer.h"
+
+using namespace dae;
+
+namespace
+{
+	//0, 1, the smallest steps next to them, the last unorm half steps in front of 1 and a spread of random depths in between, in increasing order
+	std::vector<float> GetTestDepths()
+	{
+		std::vector<float> depths{ 0.f, -0.f, 1e-30f, 1e-7f, 1.f / (1 << 24), 1.f / (1 << 16), 0.5f, 0.999f,
+			1.f - 0.75f / ((1 << 16) - 1), 1.f - 0.25f / ((1 << 16) - 1), 1.f - 0.25f / ((1 << 24) - 1), std::nextafter(1.f, 0.f), 1.f };
+		std::mt19937 random{ 16 };
+		std::uniform_real_distribution<float> depth{ 0.f, 1.f };
+		for (int i{ 0 }; i < 10000; ++i)
+			depths.push_back(depth(random));
+		std::sort(depths.begin(), depths.end());
+		return depths;
+	}
+
+	template<Depth::Format format>
+	void TestFormat(bool hasAVX2)
+	{
+		using DepthTraits = Depth::Traits<format>;
+		const char* const formatName{ Depth::GetFormatName(format) };
+		const bool isReversed{ format == Depth::D32_FLOAT_REVERSED };
+		const bool isFloat{ format == Depth::D32_FLOAT || isReversed };
+		const uint32_t clearKey{ Depth::GetClearKey(format) };
+
+		//Half a unorm step plus the rounding of the float it comes back as, the float formats have to come back exactly
+		const float tolerance{ isFloat ? 0.f : 0.5f / static_cast<float>(clearKey) + FLT_EPSILON / 2 };
+
+		//The unorm formats keep the last half step in front of the far plane out of the clear value, those depths come back one step nearer
+		const float farthestDepth{ isFloat ? 1.f : DepthTraits::ToDepth(clearKey - 1) };
+
+		const std::vector<float> depths{ GetTestDepths() };
+		uint32_t previousKey{};
+		for (size_t i{ 0 }; i < depths.size(); ++i)
+		{
+			const float depth{ depths[i] };
+			const uint32_t key{ DepthTraits::ToKey(depth) };
+			bool isValid{ true };
+
+			//Key to depth and back, and key to storage and back
+			isValid &= CHECK(DepthTraits::ToKey(DepthTraits::ToDepth(key)) == key);
+			isValid &= CHECK(DepthTraits::FromStorage(DepthTraits::ToStorage(key)) == key);
+			isValid &= CHECK(std::abs(DepthTraits::ToDepth(key) - std::min(depth + 0.f, farthestDepth)) <= tolerance);
+
+			//The SIMD kernels compare keys signed, and nothing can be farther than the clear value.
+			//Only the far plane itself of the float formats is as far, anything in front of it has to stay in front of the clear value.
+			isValid &= CHECK(key < (1u << 31));
+			isValid &= CHECK(key <= clearKey);
+			if (depth != (isReversed ? 0.f : 1.f))
+				isValid &= CHECK(key < clearKey);
+
+			//Nearer has to mean a smaller key: increasing depth is going away, unless the depth is reversed
+			if (i > 0)
+				isValid &= CHECK(isReversed ? key <= previousKey : key >= previousKey);
+			previousKey = key;
+
+			if (!isValid && Check::IsPrintingFailures())
+				std::printf("  %s, depth %.9g, key 0x%08x\n", formatName, depth, key);
+		}
+
+		//-0 can come out of a projection, its sign bit must not sort it before everything
+		CHECK(DepthTraits::ToKey(-0.f) == DepthTraits::ToKey(0.f));
+
+		//The unorm formats round the far plane and the depths just in front of it to the last step, never to the clear value
+		if (!isFloat)
+		{
+			CHECK(DepthTraits::ToKey(1.f) == clearKey - 1);
+			CHECK(DepthTraits::ToKey(std::nextafter(1.f, 0.f)) == clearKey - 1);
+			CHECK(DepthTraits::ToKey(1.f - 0.25f / static_cast<float>(clearKey)) == clearKey - 1);
+			CHECK(DepthTraits::ToKey(DepthTraits::ToDepth(clearKey - 1)) == clearKey - 1);
+		}
+
+		//The SIMD conversions and loads have to agree with the scalar ones lane for lane.
+		//The last group repeats the last depth, the depths next to the far plane are in it.
+		for (size_t i{ 0 }; i < depths.size(); i += 8)
+		{
+			float groupDepths[8]{};
+			for (size_t lane{ 0 }; lane < 8; ++lane)
+				groupDepths[lane] = depths[std::min(i + lane, depths.size() - 1)];
+
+			alignas(32) uint32_t keys[8]{};
+			typename DepthTraits::Storage stored[8]{};
+			alignas(32) uint32_t loadedKeys[8]{};
+
+			_mm_store_si128(reinterpret_cast<__m128i*>(keys), DepthTraits::ToKeys(_mm_loadu_ps(groupDepths)));
+			DepthTraits::StoreKeys4(stored, _mm_load_si128(reinterpret_cast<const __m128i*>(keys)));
+			_mm_store_si128(reinterpret_cast<__m128i*>(loadedKeys), DepthTraits::LoadKeys4(stored));
+			for (int lane{ 0 }; lane < 4; ++lane)
+			{
+				CHECK(keys[lane] == DepthTraits::ToKey(groupDepths[lane]));
+				CHECK(DepthTraits::FromStorage(stored[lane]) == keys[lane]);
+				CHECK(loadedKeys[lane] == keys[lane]);
+			}
+
+			if (!hasAVX2)
+				continue;
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(keys), DepthTraits::ToKeys(_mm256_loadu_ps(groupDepths)));
+			DepthTraits::StoreKeys8(stored, _mm256_load_si256(reinterpret_cast<const __m256i*>(keys)));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(loadedKeys), DepthTraits::LoadKeys8(stored));
+			for (int lane{ 0 }; lane < 8; ++lane)
+			{
+				CHECK(keys[lane] == DepthTraits::ToKey(groupDepths[lane]));
+				CHECK(DepthTraits::FromStorage(stored[lane]) == keys[lane]);
+				CHECK(loadedKeys[lane] == keys[lane]);
+			}
+		}
+	}
+}
+
+int main()
+{
+	//Built with AVX2 enabled, the 8 wide functions only run when the CPU has it
+	const bool hasAVX2{ Rasterizer::GetBestSupportedKernel() == Rasterizer::AVX2 };
+	if (!hasAVX2)
+		std::printf("DepthFormatTests: no AVX2, skipping the 8 wide functions\n");
+
+	TestFormat<Depth::D32_FLOAT>(hasAVX2);
+	TestFormat<Depth::D24_UNORM>(hasAVX2);
+	TestFormat<Depth::D16_UNORM>(hasAVX2);
+	TestFormat<Depth::D32_FLOAT_REVERSED>(hasAVX2);
+	return Check::Finish("DepthFormatTests");
+}
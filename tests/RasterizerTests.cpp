@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Check.h"
+#include "Rasterizer.h"
+#include "TiledLayout.h"
+
+using namespace dae;
+
+namespace
+{
+	//A grid of quads reaching past every screen edge, so every pixel center of the screen lies in exactly one triangle.
+	//Not a whole number of tiles, the triangles get cut at the tile edges and at the padded right and bottom tiles.
+	constexpr int SCREEN_WIDTH{ 150 };
+	constexpr int SCREEN_HEIGHT{ 100 };
+	constexpr int GRID_SPACING{ 8 };
+	constexpr int GRID_MARGIN{ 2 * GRID_SPACING };
+	constexpr int NUM_MESHES{ 200 };
+
+	struct TestMesh
+	{
+		std::vector<Int2> vertices{}; //Fixed point
+		std::vector<uint32_t> indices{};
+	};
+
+	//Moves every vertex up to 1.5 pixel, less than a triangle needs to fold over. Snapping to half pixels puts vertices
+	//on pixel centers and edges through them, which leaves the fill rule as the only thing deciding.
+	TestMesh BuildMesh(std::mt19937& random, bool isSnappedToHalfPixels)
+	{
+		constexpr int numColumns{ (SCREEN_WIDTH + 2 * GRID_MARGIN) / GRID_SPACING + 1 };
+		constexpr int numRows{ (SCREEN_HEIGHT + 2 * GRID_MARGIN) / GRID_SPACING + 1 };
+		constexpr int maxJitter{ 3 * Rasterizer::SUBPIXEL_HALF / 2 };
+		std::uniform_int_distribution<int> jitter{ -maxJitter, maxJitter };
+		std::bernoulli_distribution isFlipped{};
+
+		TestMesh mesh{};
+		for (int row{ 0 }; row < numRows; ++row)
+		{
+			for (int column{ 0 }; column < numColumns; ++column)
+			{
+				Int2 vertex{ (column * GRID_SPACING - GRID_MARGIN) * Rasterizer::SUBPIXEL_ONE + jitter(random),
+					(row * GRID_SPACING - GRID_MARGIN) * Rasterizer::SUBPIXEL_ONE + jitter(random) };
+				if (isSnappedToHalfPixels)
+				{
+					vertex.x = (vertex.x + Rasterizer::SUBPIXEL_HALF / 2) & ~(Rasterizer::SUBPIXEL_HALF - 1);
+					vertex.y = (vertex.y + Rasterizer::SUBPIXEL_HALF / 2) & ~(Rasterizer::SUBPIXEL_HALF - 1);
+				}
+				mesh.vertices.push_back(vertex);
+			}
+		}
+
+		//Clockwise on screen, both diagonals so the shared edges go every which way
+		for (int row{ 0 }; row + 1 < numRows; ++row)
+		{
+			for (int column{ 0 }; column + 1 < numColumns; ++column)
+			{
+				const uint32_t topLeft{ static_cast<uint32_t>(row * numColumns + column) };
+				const uint32_t topRight{ topLeft + 1 };
+				const uint32_t bottomLeft{ topLeft + numColumns };
+				const uint32_t bottomRight{ bottomLeft + 1 };
+				if (isFlipped(random))
+					mesh.indices.insert(mesh.indices.end(), { topLeft, topRight, bottomLeft, topRight, bottomRight, bottomLeft });
+				else mesh.indices.insert(mesh.indices.end(), { topLeft, topRight, bottomRight, topLeft, bottomRight, bottomLeft });
+			}
+		}
+
+		return mesh;
+	}
+
+	//The coverage test of a kernel over one row of a block: the scalar per pixel test, or the masks of groups of 4 or 8 pixels.
+	//Takes the edge functions of the first pixel of the row, calls covered(px) for every covered pixel.
+	template<typename Covered>
+	void RasterizeRow(Rasterizer::Kernel kernel, const Rasterizer::Triangle& triangle, const Rasterizer::PixelBounds& block, const int64_t (&rowWeights)[3], Covered&& covered)
+	{
+		if (kernel == Rasterizer::SCALAR)
+		{
+			for (int px{ block.min.x }; px < block.max.x; ++px)
+			{
+				bool isCovered{ true };
+				for (int edge{ 0 }; edge < 3; ++edge)
+					isCovered &= rowWeights[edge] + (px - block.min.x) * triangle.edges[edge].StepX() >= 0;
+				if (isCovered)
+					covered(px);
+			}
+			return;
+		}
+
+		//Like the kernels, the last group of a block can be partial and its lanes past the block don't count
+		auto rasterizeGroups = [&](int groupWidth, auto&& getMask)
+		{
+			int64_t weights[3]{ rowWeights[0], rowWeights[1], rowWeights[2] };
+			for (int px{ block.min.x }; px < block.max.x; px += groupWidth)
+			{
+				const int numValidLanes{ std::min(block.max.x - px, groupWidth) };
+				const int mask{ getMask(weights[0], weights[1], weights[2]) & ((1 << numValidLanes) - 1) };
+				for (int lane{ 0 }; lane < numValidLanes; ++lane)
+				{
+					if (mask & (1 << lane))
+						covered(px + lane);
+				}
+
+				for (int edge{ 0 }; edge < 3; ++edge)
+					weights[edge] += groupWidth * triangle.edges[edge].StepX();
+			}
+		};
+
+		if (kernel == Rasterizer::SSE2)
+		{
+			Rasterizer::LaneCoverage4 laneCoverage{};
+			laneCoverage.Setup(triangle);
+			rasterizeGroups(4, [&](int64_t weight0, int64_t weight1, int64_t weight2) { return laneCoverage.GetMask(weight0, weight1, weight2); });
+		}
+		else
+		{
+			Rasterizer::LaneCoverage8 laneCoverage{};
+			laneCoverage.Setup(triangle);
+			rasterizeGroups(8, [&](int64_t weight0, int64_t weight1, int64_t weight2) { return laneCoverage.GetMask(weight0, weight1, weight2); });
+		}
+	}
+
+	//How many triangles covered every pixel, set up the way the renderer sets them up: counterclockwise triangles get two
+	//vertices swapped, then cut to every tile they touch, the block walk and the coverage test of a kernel
+	std::vector<int> RasterizeMesh(const TestMesh& mesh, bool isReversed, Rasterizer::Kernel kernel)
+	{
+		std::vector<int> hits(SCREEN_WIDTH * SCREEN_HEIGHT);
+		for (size_t index{ 0 }; index < mesh.indices.size(); index += 3)
+		{
+			Int2 vertex0{ mesh.vertices[mesh.indices[index]] };
+			Int2 vertex1{ mesh.vertices[mesh.indices[index + 1]] };
+			Int2 vertex2{ mesh.vertices[mesh.indices[index + 2]] };
+			if (isReversed)
+				std::swap(vertex1, vertex2);
+
+			//Folded over triangles would cover pixels twice on purpose, the mesh has to be built without them
+			const int64_t doubleArea{ Rasterizer::GetDoubleArea(vertex0, vertex1, vertex2) };
+			CHECK(isReversed ? doubleArea < 0 : doubleArea > 0);
+			if (doubleArea < 0)
+				std::swap(vertex1, vertex2);
+
+			Rasterizer::Triangle triangle{};
+			if (!triangle.Setup(vertex0, vertex1, vertex2, SCREEN_WIDTH, SCREEN_HEIGHT))
+				continue;
+
+			for (int tileY{ triangle.bounds.min.y / TiledLayout::TILE_SIZE }; tileY <= (triangle.bounds.max.y - 1) / TiledLayout::TILE_SIZE; ++tileY)
+			{
+				for (int tileX{ triangle.bounds.min.x / TiledLayout::TILE_SIZE }; tileX <= (triangle.bounds.max.x - 1) / TiledLayout::TILE_SIZE; ++tileX)
+				{
+					Rasterizer::PixelBounds bounds{};
+					bounds.min = { std::max(tileX * TiledLayout::TILE_SIZE, triangle.bounds.min.x), std::max(tileY * TiledLayout::TILE_SIZE, triangle.bounds.min.y) };
+					bounds.max = { std::min((tileX + 1) * TiledLayout::TILE_SIZE, triangle.bounds.max.x), std::min((tileY + 1) * TiledLayout::TILE_SIZE, triangle.bounds.max.y) };
+
+					Rasterizer::WalkBlocks(triangle, bounds, [](const Rasterizer::PixelBounds&) { return false; },
+						[&](const Rasterizer::PixelBounds& block, bool isFullyCovered)
+						{
+							const int startX{ Rasterizer::PixelCenter(block.min.x) };
+							Rasterizer::RasterCounts counts{};
+							for (int py{ block.min.y }; py < block.max.y; ++py)
+							{
+								const int64_t rowWeights[3]{
+									triangle.edges[0].Evaluate(startX, Rasterizer::PixelCenter(py)) + triangle.edges[0].bias,
+									triangle.edges[1].Evaluate(startX, Rasterizer::PixelCenter(py)) + triangle.edges[1].bias,
+									triangle.edges[2].Evaluate(startX, Rasterizer::PixelCenter(py)) + triangle.edges[2].bias };
+
+								int numCovered{};
+								RasterizeRow(kernel, triangle, block, rowWeights, [&](int px)
+									{
+										++hits[px + py * SCREEN_WIDTH];
+										++numCovered;
+									});
+
+								//A block that tested inside has to be inside at every pixel, the kernels skip the edge tests there
+								CHECK(numCovered == block.max.x - block.min.x || !isFullyCovered);
+								counts.coveredPixels += numCovered;
+							}
+							return counts;
+						});
+				}
+			}
+		}
+		return hits;
+	}
+
+	void TestSharedEdges(bool isSnappedToHalfPixels, Rasterizer::Kernel bestKernel)
+	{
+		std::mt19937 random{ isSnappedToHalfPixels ? 2u : 1u };
+		for (int meshIndex{ 0 }; meshIndex < NUM_MESHES; ++meshIndex)
+		{
+			const TestMesh mesh{ BuildMesh(random, isSnappedToHalfPixels) };
+			for (const bool isReversed : { false, true })
+			{
+				for (int kernel{ Rasterizer::SCALAR }; kernel <= bestKernel; ++kernel)
+				{
+					const std::vector<int> hits{ RasterizeMesh(mesh, isReversed, static_cast<Rasterizer::Kernel>(kernel)) };
+					for (int pixel{ 0 }; pixel < SCREEN_WIDTH * SCREEN_HEIGHT; ++pixel)
+					{
+						//Exactly once, a seam would leave a hole and a doubled edge would blend twice
+						if (!CHECK(hits[pixel] == 1) && Check::IsPrintingFailures())
+							std::printf("  %s, mesh %d%s%s, pixel (%d, %d) covered %d times\n", Rasterizer::GetKernelName(static_cast<Rasterizer::Kernel>(kernel)), meshIndex,
+								isSnappedToHalfPixels ? " snapped" : "", isReversed ? " reversed" : "", pixel % SCREEN_WIDTH, pixel / SCREEN_WIDTH, hits[pixel]);
+					}
+				}
+			}
+		}
+	}
+
+	void TestTopLeftRule()
+	{
+		//Edges straight through pixel centers, so only the fill rule decides. A flat top edge owns its pixels, a flat bottom one doesn't.
+		const Int2 topLeft{ Rasterizer::PixelCenter(2), Rasterizer::PixelCenter(2) };
+		const Int2 topRight{ Rasterizer::PixelCenter(6), Rasterizer::PixelCenter(2) };
+		const Int2 bottomLeft{ Rasterizer::PixelCenter(2), Rasterizer::PixelCenter(6) };
+		const Int2 bottomRight{ Rasterizer::PixelCenter(6), Rasterizer::PixelCenter(6) };
+
+		Rasterizer::Triangle upper{};
+		CHECK(upper.Setup(topLeft, topRight, bottomRight, SCREEN_WIDTH, SCREEN_HEIGHT));
+		Rasterizer::Triangle lower{};
+		CHECK(lower.Setup(topLeft, bottomRight, bottomLeft, SCREEN_WIDTH, SCREEN_HEIGHT));
+
+		auto isCovered = [](const Rasterizer::Triangle& triangle, int px, int py)
+		{
+			bool isInside{ true };
+			for (const Rasterizer::EdgeFunction& edge : triangle.edges)
+				isInside &= edge.Evaluate(Rasterizer::PixelCenter(px), Rasterizer::PixelCenter(py)) + edge.bias >= 0;
+			return isInside;
+		};
+
+		CHECK(isCovered(upper, 4, 2)); //Top edge
+		CHECK(!isCovered(lower, 4, 6)); //Bottom edge
+		CHECK(isCovered(lower, 2, 4)); //Left edge
+		CHECK(!isCovered(upper, 6, 4)); //Right edge
+		CHECK(isCovered(upper, 2, 2)); //Top left corner, both edges are top or left
+		CHECK(isCovered(upper, 4, 4) != isCovered(lower, 4, 4)); //On the shared diagonal
+	}
+}
+
+int main()
+{
+	//Built with AVX2 enabled, the 8 wide masks only run when the CPU has it
+	const Rasterizer::Kernel bestKernel{ Rasterizer::GetBestSupportedKernel() };
+	if (bestKernel != Rasterizer::AVX2)
+		std::printf("RasterizerTests: no AVX2, skipping the 8 wide coverage masks\n");
+
+	TestTopLeftRule();
+	TestSharedEdges(false, bestKernel);
+	TestSharedEdges(true, bestKernel);
+	return Check::Finish("RasterizerTests");
+}
@@ -0,0 +1,116 @@
+#include <cfloat>
+#include <cmath>
+#include <random>
+
+#include "Check.h"
+#include "Rasterizer.h"
+#include "SimdMath.h"
+
+using namespace dae;
+
+namespace
+{
+	constexpr int NUM_VALUES{ 1000000 };
+
+	//The same value in every lane, and every lane has to come out the same
+	template<typename Function>
+	float CallScalar(Function&& function, float value)
+	{
+		alignas(32) float results[8]{};
+		_mm256_store_ps(results, function(_mm256_set1_ps(value)));
+		for (int lane{ 1 }; lane < 8; ++lane)
+			CHECK(results[lane] == results[0]);
+		return results[0];
+	}
+
+	void TestLog2()
+	{
+		//Normal floats only, Pow never passes it anything smaller
+		std::mt19937 random{ 23 };
+		std::uniform_real_distribution<float> mantissa{ 1.f, 2.f };
+		std::uniform_int_distribution<int> exponent{ -126, 127 };
+		for (int i{ 0 }; i < NUM_VALUES; ++i)
+		{
+			const float x{ std::ldexp(mantissa(random), exponent(random)) };
+			const float log2{ CallScalar(SimdMath::Log2, x) };
+			const float expected{ log2f(x) };
+
+			//Absolute near 0 where log2 crosses it, relative everywhere else
+			if (!CHECK(std::abs(log2 - expected) <= 2 * FLT_EPSILON * std::max(1.f, std::abs(expected))) && Check::IsPrintingFailures())
+				std::printf("  Log2(%.9g) = %.9g instead of %.9g\n", x, log2, expected);
+		}
+	}
+
+	void TestExp2()
+	{
+		std::mt19937 random{ 23 };
+		std::uniform_real_distribution<float> exponent{ -126.f, 127.f };
+		for (int i{ 0 }; i < NUM_VALUES; ++i)
+		{
+			const float x{ exponent(random) };
+			const float exp2{ CallScalar(SimdMath::Exp2, x) };
+			const float expected{ exp2f(x) };
+			if (!CHECK(std::abs(exp2 - expected) <= 2 * FLT_EPSILON * expected) && Check::IsPrintingFailures())
+				std::printf("  Exp2(%.9g) = %.9g instead of %.9g\n", x, exp2, expected);
+		}
+
+		//Clamped to the normal range, the shading only needs 0 to come out as good as 0
+		CHECK(CallScalar(SimdMath::Exp2, -200.f) <= FLT_MIN);
+		CHECK(CallScalar(SimdMath::Exp2, 0.f) == 1.f);
+	}
+
+	void TestPow()
+	{
+		//The specular term: a cosine, above 1 only by rounding and in the table fallback, to the glossiness times a shininess of 25.
+		//Pow is Exp2(exponent * Log2(base)), so the error of Log2 grows with the power of 2 the result ends up at.
+		auto pow = [](float base, float exponent)
+		{
+			alignas(32) float results[8]{};
+			_mm256_store_ps(results, SimdMath::Pow(_mm256_set1_ps(base), _mm256_set1_ps(exponent)));
+			return results[0];
+		};
+
+		std::mt19937 random{ 23 };
+		std::uniform_real_distribution<float> base{ 0.f, 1.5f };
+		std::uniform_real_distribution<float> exponent{ 0.f, 25.f };
+		for (int i{ 0 }; i < NUM_VALUES; ++i)
+		{
+			//Every fourth base a lot closer to 0, results down to the smallest normal float
+			float x{ base(random) };
+			if (i % 4 == 0)
+				x = std::ldexp(x, -static_cast<int>(exponent(random)) * 5);
+			if (x < FLT_MIN)
+				continue;
+
+			const float y{ exponent(random) };
+			const float result{ pow(x, y) };
+			const float expected{ powf(x, y) };
+			const float tolerance{ expected < FLT_MIN ? FLT_MIN : 2 * FLT_EPSILON * (1.f + std::abs(y * std::log2(x))) * expected };
+			if (!CHECK(std::abs(result - expected) <= tolerance) && Check::IsPrintingFailures())
+				std::printf("  Pow(%.9g, %.9g) = %.9g instead of %.9g\n", x, y, result, expected);
+		}
+
+		//The cases the shading relies on: a base of 0 and 1, and an exponent of 0 and 1
+		CHECK(pow(0.f, 0.f) == 1.f);
+		CHECK(pow(0.f, 0.1f) == 0.f);
+		CHECK(pow(0.f, 25.f) == 0.f);
+		CHECK(pow(1.f, 25.f) == 1.f);
+		CHECK(pow(0.5f, 0.f) == 1.f);
+		CHECK(std::abs(pow(0.5f, 1.f) - 0.5f) <= FLT_EPSILON);
+	}
+}
+
+int main()
+{
+	//Built with AVX2 enabled, there is nothing to test on a CPU without it
+	if (Rasterizer::GetBestSupportedKernel() != Rasterizer::AVX2)
+	{
+		std::printf("SimdMathTests: no AVX2, skipped\n");
+		return 0;
+	}
+
+	TestLog2();
+	TestExp2();
+	TestPow();
+	return Check::Finish("SimdMathTests");
+}
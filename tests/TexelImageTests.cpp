@@ -0,0 +1,109 @@
+#include <random>
+#include <vector>
+
+#include "Check.h"
+#include "Rasterizer.h"
+#include "TexelImage.h"
+
+using namespace dae;
+
+namespace
+{
+	//Random texels in rows with padding after them, like a surface with a wider pitch than its width
+	struct SourceImage
+	{
+		int width{};
+		int height{};
+		int pitch{}; //In bytes
+		std::vector<uint32_t> pixels{};
+
+		uint32_t GetPixel(int x, int y) const { return pixels[y * (pitch / sizeof(uint32_t)) + x]; }
+	};
+
+	SourceImage BuildSourceImage(int width, int height, std::mt19937& random)
+	{
+		SourceImage image{ width, height, (width + 3) * static_cast<int>(sizeof(uint32_t)) };
+		image.pixels.resize(image.pitch / sizeof(uint32_t) * height);
+		for (uint32_t& pixel : image.pixels)
+			pixel = static_cast<uint32_t>(random());
+		return image;
+	}
+
+	//Every texel has to be where GetTexel looks for it, and GatherTexels has to find the same 8 texels
+	void CheckImage(const TexelImage& image, const SourceImage& source, bool hasAVX2, std::mt19937& random)
+	{
+		const char* const layoutName{ TexelImage::GetLayoutName(image.GetLayout()) };
+		CHECK(image.GetWidth() == source.width);
+		CHECK(image.GetHeight() == source.height);
+
+		for (int y{ 0 }; y < source.height; ++y)
+		{
+			for (int x{ 0 }; x < source.width; ++x)
+			{
+				if (!CHECK(image.GetTexel(x, y) == source.GetPixel(x, y)) && Check::IsPrintingFailures())
+					std::printf("  %s %dx%d, texel (%d, %d)\n", layoutName, source.width, source.height, x, y);
+			}
+		}
+
+		if (!hasAVX2)
+			return;
+
+		std::uniform_int_distribution<int> randomX{ 0, source.width - 1 };
+		std::uniform_int_distribution<int> randomY{ 0, source.height - 1 };
+		for (int i{ 0 }; i < 1000; ++i)
+		{
+			alignas(32) int x[8]{};
+			alignas(32) int y[8]{};
+			for (int lane{ 0 }; lane < 8; ++lane)
+			{
+				x[lane] = randomX(random);
+				y[lane] = randomY(random);
+			}
+
+			alignas(32) uint32_t texels[8]{};
+			_mm256_store_si256(reinterpret_cast<__m256i*>(texels),
+				image.GatherTexels(_mm256_load_si256(reinterpret_cast<const __m256i*>(x)), _mm256_load_si256(reinterpret_cast<const __m256i*>(y))));
+			for (int lane{ 0 }; lane < 8; ++lane)
+			{
+				if (!CHECK(texels[lane] == source.GetPixel(x[lane], y[lane])) && Check::IsPrintingFailures())
+					std::printf("  %s %dx%d, gathered texel (%d, %d)\n", layoutName, source.width, source.height, x[lane], y[lane]);
+			}
+		}
+	}
+
+	void TestImage(int width, int height, bool hasAVX2, std::mt19937& random)
+	{
+		const SourceImage source{ BuildSourceImage(width, height, random) };
+
+		//Built in a layout, and reordered into it from the other one
+		for (int layout{ 0 }; layout < TexelImage::NUM_LAYOUTS; ++layout)
+		{
+			TexelImage image{ source.pixels.data(), width, height, source.pitch, static_cast<TexelImage::Layout>(layout) };
+			CHECK(image.GetLayout() == layout);
+			CheckImage(image, source, hasAVX2, random);
+
+			for (int otherLayout{ 0 }; otherLayout < TexelImage::NUM_LAYOUTS; ++otherLayout)
+			{
+				image.SetLayout(static_cast<TexelImage::Layout>(otherLayout));
+				CHECK(image.GetLayout() == otherLayout);
+				CheckImage(image, source, hasAVX2, random);
+			}
+		}
+	}
+}
+
+int main()
+{
+	//Built with AVX2 enabled, GatherTexels only runs when the CPU has it
+	const bool hasAVX2{ Rasterizer::GetBestSupportedKernel() == Rasterizer::AVX2 };
+	if (!hasAVX2)
+		std::printf("TexelImageTests: no AVX2, skipping GatherTexels\n");
+
+	//Whole Morton tiles, partial ones on the right and bottom, and images smaller than one tile
+	std::mt19937 random{ 25 };
+	const int sizes[][2]{ { 1, 1 }, { 7, 3 }, { 32, 32 }, { 33, 31 }, { 64, 96 }, { 100, 70 }, { 129, 5 }, { 512, 512 } };
+	for (const auto& size : sizes)
+		TestImage(size[0], size[1], hasAVX2, random);
+
+	return Check::Finish("TexelImageTests");
+}